@@ -241,7 +241,7 @@ int cli_find_bit(int argc, char **argv, struct Queue queues[2]) {
 }
 
 static int cli_merge_queues(struct Queue queues[2]) {
-    if (queues[0].size + queues[1].size >= QUEUE_MAX_LENGTH) {
+    if (queues[0].size + queues[1].size > QUEUE_MAX_LENGTH) {
         fprintf(
             stderr,
             "Can't merge queues since their combined size exceeds the limit\n");
@@ -302,7 +302,9 @@ static void load_queue(struct Queue *queue, const char *file_name) {
         return;
     }
     unsigned counter = 0;
-    for (;;) {
+    // Extra values of a corrupted file are ignored rather than overflowing
+    // the queue.
+    while (counter != QUEUE_MAX_LENGTH) {
         uint32_t value;
         size_t rc = fread(&value, sizeof(uint32_t), 1, f);
         if (rc != 1) {
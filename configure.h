@@ -15,3 +15,37 @@
 /// Defines a queue mode.
 #define QUEUE_MODE QUEUE_MODE_LIFO
 #endif  // QUEUE_MODE
+
+#ifndef SHARDED_QUEUE_MAX_SHARDS
+/// A maximum number of shards in a sharded queue.
+#define SHARDED_QUEUE_MAX_SHARDS 64
+#endif  // SHARDED_QUEUE_MAX_SHARDS
+
+#ifndef QUEUE_MERGE_MAX_WAYS
+/// A maximum number of queues a sorted merge iterator can merge at once.
+#define QUEUE_MERGE_MAX_WAYS 64
+#endif  // QUEUE_MERGE_MAX_WAYS
+
+#ifndef COW_QUEUE_CHUNK_LENGTH
+/// A number of elements in a single chunk of a copy-on-write queue, i.e. the
+/// granularity of copying on modifications.
+#define COW_QUEUE_CHUNK_LENGTH 64
+#endif  // COW_QUEUE_CHUNK_LENGTH
+
+#ifndef TIMER_WHEEL_BITS
+/// A binary logarithm of the number of buckets on every level of a timer
+/// wheel.
+#define TIMER_WHEEL_BITS 6
+#endif  // TIMER_WHEEL_BITS
+
+#ifndef TIMER_WHEEL_LEVELS
+/// A number of levels of a timer wheel. The wheel covers
+/// `2^(TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)` ticks ahead, timers further in
+/// the future are re-inserted as the time goes by.
+#define TIMER_WHEEL_LEVELS 4
+#endif  // TIMER_WHEEL_LEVELS
+
+#ifndef TIMER_WHEEL_CAPACITY
+/// A maximum number of timers in a timer wheel.
+#define TIMER_WHEEL_CAPACITY 1024
+#endif  // TIMER_WHEEL_CAPACITY
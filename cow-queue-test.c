@@ -0,0 +1,207 @@
+/// Testing the `cow-queue` module.
+///
+/// To run the tests, first compile this file with the `cow-queue.c` and
+/// `queue.c`, while passing `-DQUEUE_MAX_LENGTH=5` and
+/// `-DCOW_QUEUE_CHUNK_LENGTH=2` flags to the compiler:
+///
+/// ```
+/// $ clang -DQUEUE_MAX_LENGTH=5 -DCOW_QUEUE_CHUNK_LENGTH=2 cow-queue-test.c cow-queue.c queue.c -lpthread -ocow-queue-test
+/// ```
+///
+/// ... and the run it:
+///
+/// ```
+/// $ ./cow-queue-test
+/// ```
+///
+/// On successful execution the return code will be zero; some output is
+/// expected.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cow-queue.h"
+
+#if QUEUE_MAX_LENGTH != 5
+#error Max queue length should be 5
+#endif
+
+#if COW_QUEUE_CHUNK_LENGTH != 2
+#error Chunk length should be 2
+#endif
+
+/// This macro expects a pointer to a `CowQueue` object and a `reference`
+/// array, which should be a stack-allocated array (like `uint32_t ref[] =
+/// {...};`).
+#define CHECK_QUEUE(queue, reference)                                       \
+    {                                                                       \
+        unsigned len = sizeof(reference) / sizeof(reference[0]);            \
+        assert(len == (queue)->size &&                                      \
+               "Wrong array size passed to CHECK_QUEUE");                   \
+        uint32_t* test_array = malloc(len * sizeof(uint32_t));              \
+        cow_queue_copy_to((queue), test_array);                             \
+        assert(memcmp(test_array, reference, len * sizeof(uint32_t)) == 0); \
+        free(test_array);                                                   \
+    }
+
+/// Makes a queue of `{1, 2, 3, 4}`, which occupies storage slots 1 to 4.
+static void make_initial(struct CowQueue* queue) {
+    cow_queue_init(queue);
+    for (uint32_t i = 4; i != 0; --i) {
+        assert(cow_queue_push_back(queue, i) == 0);
+    }
+    assert(queue->begin == 1);
+    {
+        uint32_t reference_array[] = {1, 2, 3, 4};
+        CHECK_QUEUE(queue, reference_array);
+    }
+}
+
+static void test_push_pop() {
+    struct CowQueue queue;
+    make_initial(&queue);
+    assert(cow_queue_push_back(&queue, 15) == 0);
+    assert(cow_queue_push_back(&queue, 10) == -1);
+    {
+        uint32_t reference_array[] = {15, 1, 2, 3, 4};
+        CHECK_QUEUE(&queue, reference_array);
+    }
+    uint32_t value;
+    assert(cow_queue_pop_back(&queue, &value) == 0);
+    assert(value == 15);
+    assert(cow_queue_pop_front(&queue, &value) == 0);
+    assert(value == 4);
+    // Wrap around the end of the storage.
+    assert(cow_queue_push_back(&queue, 7) == 0);
+    assert(cow_queue_push_back(&queue, 8) == 0);
+    assert(queue.begin == 4);
+    {
+        uint32_t reference_array[] = {8, 7, 1, 2, 3};
+        CHECK_QUEUE(&queue, reference_array);
+    }
+    assert(cow_queue_remove(&queue, 1) == 0);
+    {
+        uint32_t reference_array[] = {8, 1, 2, 3};
+        CHECK_QUEUE(&queue, reference_array);
+    }
+    cow_queue_destroy(&queue);
+    assert(cow_queue_pop_back(&queue, &value) == -1);
+}
+
+static void test_clone() {
+    struct CowQueue queue, clone;
+    make_initial(&queue);
+    cow_queue_clone(&clone, &queue);
+    assert(clone.table == queue.table);
+    assert(atomic_load(&queue.table->refs) == 2);
+
+    // Pops don't touch the storage.
+    uint32_t value;
+    assert(cow_queue_pop_front(&queue, &value) == 0);
+    assert(clone.table == queue.table);
+
+    // The slot 0 lives in the first chunk, so only that one gets copied.
+    assert(cow_queue_push_back(&queue, 10) == 0);
+    assert(clone.table != queue.table);
+    assert(clone.table->chunks[0] != queue.table->chunks[0]);
+    assert(clone.table->chunks[1] == queue.table->chunks[1]);
+    assert(clone.table->chunks[2] == queue.table->chunks[2]);
+    assert(atomic_load(&queue.table->chunks[1]->refs) == 2);
+    {
+        uint32_t reference_array[] = {10, 1, 2, 3};
+        CHECK_QUEUE(&queue, reference_array);
+    }
+    {
+        uint32_t reference_array[] = {1, 2, 3, 4};
+        CHECK_QUEUE(&clone, reference_array);
+    }
+
+    // The table is no longer shared, but some chunks still are. Removal
+    // shifts the slots 1 and 2, hence the last chunk stays shared.
+    assert(cow_queue_remove(&queue, 1) == 0);
+    assert(clone.table->chunks[1] != queue.table->chunks[1]);
+    assert(clone.table->chunks[2] == queue.table->chunks[2]);
+    {
+        uint32_t reference_array[] = {10, 2, 3};
+        CHECK_QUEUE(&queue, reference_array);
+    }
+    {
+        uint32_t reference_array[] = {1, 2, 3, 4};
+        CHECK_QUEUE(&clone, reference_array);
+    }
+
+    // Once the clone is gone, the storage is modified in place.
+    cow_queue_destroy(&clone);
+    struct CowQueueTable* table = queue.table;
+    struct CowQueueChunk* chunk = queue.table->chunks[2];
+    assert(cow_queue_push_back(&queue, 11) == 0);
+    assert(queue.table == table);
+    assert(queue.table->chunks[2] == chunk);
+    cow_queue_destroy(&queue);
+}
+
+static void test_from_queue() {
+    struct Queue source;
+    queue_init(&source);
+    for (uint32_t i = 5; i != 0; --i) {
+        assert(queue_push_back(&source, i) == 0);
+    }
+    struct CowQueue queue;
+    assert(cow_queue_from_queue(&queue, &source) == 0);
+    {
+        uint32_t reference_array[] = {1, 2, 3, 4, 5};
+        CHECK_QUEUE(&queue, reference_array);
+    }
+    cow_queue_destroy(&queue);
+}
+
+/// Arguments of the `snapshot_reader` thread.
+struct SnapshotArgs {
+    /// A snapshot to scan.
+    struct CowQueue snapshot;
+    /// Expected contents of the snapshot.
+    uint32_t expected[QUEUE_MAX_LENGTH];
+};
+
+/// Repeatedly scans a snapshot, checking it never changes.
+static void* snapshot_reader(void* arg) {
+    struct SnapshotArgs* args = arg;
+    for (unsigned round = 0; round != 10000; ++round) {
+        for (unsigned i = 0; i != args->snapshot.size; ++i) {
+            uint32_t value = cow_queue_get_value(&args->snapshot, i);
+            assert(value == args->expected[i]);
+        }
+    }
+    cow_queue_destroy(&args->snapshot);
+    return NULL;
+}
+
+static void test_concurrent_snapshot() {
+    struct CowQueue queue;
+    make_initial(&queue);
+    struct SnapshotArgs args;
+    cow_queue_clone(&args.snapshot, &queue);
+    cow_queue_copy_to(&queue, args.expected);
+    pthread_t reader;
+    assert(pthread_create(&reader, NULL, snapshot_reader, &args) == 0);
+    // Keep on modifying the original meanwhile.
+    for (uint32_t i = 0; i != 10000; ++i) {
+        uint32_t value;
+        assert(cow_queue_pop_front(&queue, &value) == 0);
+        assert(cow_queue_push_back(&queue, i) == 0);
+    }
+    pthread_join(reader, NULL);
+    cow_queue_destroy(&queue);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    test_push_pop();
+    test_clone();
+    test_from_queue();
+    test_concurrent_snapshot();
+}
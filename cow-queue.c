@@ -0,0 +1,197 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cow-queue.h"
+
+/// Drops a reference to a chunk, freeing it if that was the last one.
+static void cow_queue_chunk_release(struct CowQueueChunk *chunk);
+
+/// Drops a reference to a table, releasing it along with its chunks if that
+/// was the last one.
+static void cow_queue_table_release(struct CowQueueTable *table);
+
+/// Returns a pointer to a given storage slot (not an index!) which is safe to
+/// write to, copying the table and the chunk if they are shared or allocating
+/// them if they don't exist yet. Returns `NULL` on allocation failures.
+static uint32_t *cow_queue_slot_mut(struct CowQueue *queue, unsigned slot);
+
+/// Returns a value stored in a given storage slot.
+static uint32_t cow_queue_slot(const struct CowQueue *queue, unsigned slot);
+
+void cow_queue_chunk_release(struct CowQueueChunk *chunk) {
+    if (chunk != NULL &&
+        atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) == 1) {
+        free(chunk);
+    }
+}
+
+void cow_queue_table_release(struct CowQueueTable *table) {
+    if (table == NULL ||
+        atomic_fetch_sub_explicit(&table->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    for (unsigned i = 0; i != COW_QUEUE_CHUNKS; ++i) {
+        cow_queue_chunk_release(table->chunks[i]);
+    }
+    free(table);
+}
+
+uint32_t *cow_queue_slot_mut(struct CowQueue *queue, unsigned slot) {
+    struct CowQueueTable *table = queue->table;
+    if (table == NULL ||
+        atomic_load_explicit(&table->refs, memory_order_acquire) != 1) {
+        // The table is either missing or shared with a clone, so we need our
+        // own one. The chunks stay shared.
+        struct CowQueueTable *new_table = malloc(sizeof(struct CowQueueTable));
+        if (new_table == NULL) {
+            fprintf(stderr, "Can't allocate a queue storage table\n");
+            return NULL;
+        }
+        atomic_init(&new_table->refs, 1);
+        for (unsigned i = 0; i != COW_QUEUE_CHUNKS; ++i) {
+            struct CowQueueChunk *chunk =
+                (table == NULL) ? NULL : table->chunks[i];
+            if (chunk != NULL) {
+                atomic_fetch_add_explicit(&chunk->refs, 1,
+                                          memory_order_relaxed);
+            }
+            new_table->chunks[i] = chunk;
+        }
+        cow_queue_table_release(table);
+        queue->table = table = new_table;
+    }
+
+    struct CowQueueChunk **chunk =
+        &table->chunks[slot / COW_QUEUE_CHUNK_LENGTH];
+    if (*chunk == NULL ||
+        atomic_load_explicit(&(*chunk)->refs, memory_order_acquire) != 1) {
+        struct CowQueueChunk *new_chunk = malloc(sizeof(struct CowQueueChunk));
+        if (new_chunk == NULL) {
+            fprintf(stderr, "Can't allocate a queue storage chunk\n");
+            return NULL;
+        }
+        atomic_init(&new_chunk->refs, 1);
+        if (*chunk == NULL) {
+            memset(new_chunk->array, 0, sizeof(new_chunk->array));
+        } else {
+            memcpy(new_chunk->array, (*chunk)->array, sizeof(new_chunk->array));
+        }
+        cow_queue_chunk_release(*chunk);
+        *chunk = new_chunk;
+    }
+    return &(*chunk)->array[slot % COW_QUEUE_CHUNK_LENGTH];
+}
+
+uint32_t cow_queue_slot(const struct CowQueue *queue, unsigned slot) {
+    const struct CowQueueChunk *chunk =
+        queue->table->chunks[slot / COW_QUEUE_CHUNK_LENGTH];
+    return chunk->array[slot % COW_QUEUE_CHUNK_LENGTH];
+}
+
+void cow_queue_init(struct CowQueue *queue) {
+    queue->begin = 0;
+    queue->size = 0;
+    queue->table = NULL;
+}
+
+void cow_queue_destroy(struct CowQueue *queue) {
+    cow_queue_table_release(queue->table);
+    cow_queue_init(queue);
+}
+
+void cow_queue_clone(struct CowQueue *clone, const struct CowQueue *queue) {
+    clone->begin = queue->begin;
+    clone->size = queue->size;
+    clone->table = queue->table;
+    if (clone->table != NULL) {
+        atomic_fetch_add_explicit(&clone->table->refs, 1, memory_order_relaxed);
+    }
+}
+
+int cow_queue_push_back(struct CowQueue *queue, uint32_t value) {
+    if (queue->size == QUEUE_MAX_LENGTH) {
+        fprintf(stderr,
+                "Can't enqueue an element since the capacity of the queue has "
+                "been reached\n");
+        return -1;
+    }
+    unsigned begin =
+        (queue->begin == 0) ? QUEUE_MAX_LENGTH - 1 : queue->begin - 1;
+    uint32_t *slot = cow_queue_slot_mut(queue, begin);
+    if (slot == NULL) {
+        return -1;
+    }
+    *slot = value;
+    queue->begin = begin;
+    queue->size += 1;
+    return 0;
+}
+
+int cow_queue_pop_back(struct CowQueue *queue, uint32_t *value) {
+    if (queue->size == 0) {
+        fprintf(stderr, "Can't pop an element: the queue is empty\n");
+        return -1;
+    }
+    *value = cow_queue_slot(queue, queue->begin);
+    if (queue->begin == QUEUE_MAX_LENGTH - 1) {
+        queue->begin = 0;
+    } else {
+        queue->begin += 1;
+    }
+    queue->size -= 1;
+    return 0;
+}
+
+int cow_queue_pop_front(struct CowQueue *queue, uint32_t *value) {
+    if (queue->size == 0) {
+        fprintf(stderr, "Can't pop an element: the queue is empty\n");
+        return -1;
+    }
+    *value = cow_queue_get_value(queue, queue->size - 1);
+    queue->size -= 1;
+    return 0;
+}
+
+int cow_queue_remove(struct CowQueue *queue, unsigned index) {
+    assert(index < queue->size);
+    unsigned first = queue->begin + index;
+    unsigned last = queue->begin + queue->size - 1;
+    // Unshare all the affected chunks beforehand, so an allocation failure
+    // doesn't leave the queue half-shifted. Once unshared, the slots are
+    // written to in place.
+    for (unsigned _i = first; _i != last; ++_i) {
+        if (cow_queue_slot_mut(queue, _i % QUEUE_MAX_LENGTH) == NULL) {
+            return -1;
+        }
+    }
+    for (unsigned _i = first; _i != last; ++_i) {
+        *cow_queue_slot_mut(queue, _i % QUEUE_MAX_LENGTH) =
+            cow_queue_slot(queue, (_i + 1) % QUEUE_MAX_LENGTH);
+    }
+    queue->size -= 1;
+    return 0;
+}
+
+uint32_t cow_queue_get_value(const struct CowQueue *queue, unsigned index) {
+    assert(index < queue->size);
+    return cow_queue_slot(queue, (queue->begin + index) % QUEUE_MAX_LENGTH);
+}
+
+void cow_queue_copy_to(const struct CowQueue *queue, uint32_t *destination) {
+    for (unsigned i = 0; i != queue->size; ++i) {
+        destination[i] = cow_queue_get_value(queue, i);
+    }
+}
+
+int cow_queue_from_queue(struct CowQueue *queue, const struct Queue *source) {
+    cow_queue_init(queue);
+    for (unsigned i = source->size; i != 0; --i) {
+        if (cow_queue_push_back(queue, queue_get_value(source, i - 1)) == -1) {
+            cow_queue_destroy(queue);
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "configure.h"
+#include "queue.h"
+
+/// A number of chunks which covers `QUEUE_MAX_LENGTH` elements.
+#define COW_QUEUE_CHUNKS \
+    ((QUEUE_MAX_LENGTH + COW_QUEUE_CHUNK_LENGTH - 1) / COW_QUEUE_CHUNK_LENGTH)
+
+/// A reference-counted piece of a copy-on-write queue storage.
+struct CowQueueChunk {
+    /// Number of the tables referring to the chunk.
+    atomic_uint refs;
+    /// The elements.
+    uint32_t array[COW_QUEUE_CHUNK_LENGTH];
+};
+
+/// A reference-counted table of chunks, shared between the clones of a queue.
+struct CowQueueTable {
+    /// Number of the queues referring to the table.
+    atomic_uint refs;
+    /// The chunks; a chunk which has never been written to is `NULL`.
+    struct CowQueueChunk *chunks[COW_QUEUE_CHUNKS];
+};
+
+/// A double-ended queue with the same layout and semantics as the `Queue`, but
+/// with a copy-on-write chunked storage, so it can be cloned in O(1).
+///
+/// The storage array of a `Queue` is split into chunks of
+/// `COW_QUEUE_CHUNK_LENGTH` elements, which are referred to by a table. Clones
+/// share the table, and a modification of a shared storage duplicates the
+/// table (which only bumps the reference counters of the chunks) and then the
+/// modified chunk alone:
+///
+/// ```
+///  original   clone                 original     clone
+///       \     /                         |          |
+///      table (2)       push ->       table (1)  table (1)
+///       /     \                        |    \    /    |
+///  chunk (1)  chunk (1)         chunk' (1)  chunk (2)  chunk (1)
+/// ```
+///
+/// Popping elements doesn't touch the storage at all, hence never copies.
+///
+/// A clone is a stable snapshot: it can be read (say, printed or exported) by
+/// one thread while another one keeps modifying the original. Cloning itself,
+/// though, should be serialized with the modifications of the source queue,
+/// as well as any other access to a single `CowQueue` object.
+struct CowQueue {
+    /// Number of the front element in the storage.
+    unsigned begin;
+    /// Current size of the queue.
+    unsigned size;
+    /// The storage; `NULL` until something is pushed.
+    struct CowQueueTable *table;
+};
+
+/// Initializes an empty queue. Doesn't allocate.
+void cow_queue_init(struct CowQueue *queue);
+
+/// Releases the storage of a queue. The storage is freed when the last clone
+/// referring to it is destroyed.
+void cow_queue_destroy(struct CowQueue *queue);
+
+/// Initializes the `clone` as a copy of the `queue` sharing the same storage.
+void cow_queue_clone(struct CowQueue *clone, const struct CowQueue *queue);
+
+/// Pushes a value to the 'back' (i.e. 'begin') of a queue. Returns -1 if the
+/// queue is full or if the storage can't be allocated.
+int cow_queue_push_back(struct CowQueue *queue, uint32_t value);
+
+/// Pops the 'back' (i.e. 'first') element of the queue.
+int cow_queue_pop_back(struct CowQueue *queue, uint32_t *value);
+
+/// Pops the 'front' (i.e. 'last') element from the queue.
+int cow_queue_pop_front(struct CowQueue *queue, uint32_t *value);
+
+/// Removes a given index from a queue. The index is expected to lie within the
+/// bounds of the queue. Returns -1 if the storage can't be allocated.
+int cow_queue_remove(struct CowQueue *queue, unsigned index);
+
+/// Returns a value stored at a given index. Index should lie within the bounds
+/// of the queue.
+uint32_t cow_queue_get_value(const struct CowQueue *queue, unsigned index);
+
+/// Copies the contents of a queue into an array. Size of the array should match
+/// the size of the queue.
+void cow_queue_copy_to(const struct CowQueue *queue, uint32_t *destination);
+
+/// Initializes a copy-on-write queue with the contents of a plain `Queue`.
+/// Returns -1 if the storage can't be allocated.
+int cow_queue_from_queue(struct CowQueue *queue, const struct Queue *source);
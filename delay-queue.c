@@ -0,0 +1,82 @@
+#include <assert.h>
+#include <time.h>
+
+#include "delay-queue.h"
+
+void delay_queue_init(struct DelayQueue *queue) {
+    pthread_mutex_init(&queue->lock, NULL);
+    // The deadlines are measured with the monotonic clock, so should be the
+    // waits.
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue->scheduled, &attr);
+    pthread_condattr_destroy(&attr);
+    timer_wheel_init(&queue->wheel, delay_queue_now());
+}
+
+void delay_queue_destroy(struct DelayQueue *queue) {
+    pthread_cond_destroy(&queue->scheduled);
+    pthread_mutex_destroy(&queue->lock);
+}
+
+uint64_t delay_queue_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int delay_queue_schedule(struct DelayQueue *queue, uint32_t value,
+                         uint64_t delay_ms, uint32_t *handle) {
+    uint64_t due = delay_queue_now() + delay_ms;
+    pthread_mutex_lock(&queue->lock);
+    int rc = timer_wheel_insert(&queue->wheel, value, due, handle);
+    pthread_mutex_unlock(&queue->lock);
+    if (rc == 0) {
+        // The new value might be due earlier than what the consumers are
+        // waiting for.
+        pthread_cond_broadcast(&queue->scheduled);
+    }
+    return rc;
+}
+
+int delay_queue_cancel(struct DelayQueue *queue, uint32_t handle) {
+    pthread_mutex_lock(&queue->lock);
+    int rc = timer_wheel_cancel(&queue->wheel, handle);
+    pthread_mutex_unlock(&queue->lock);
+    return rc;
+}
+
+unsigned delay_queue_pop_expired(struct DelayQueue *queue, uint32_t *values,
+                                 unsigned max_count) {
+    pthread_mutex_lock(&queue->lock);
+    unsigned written = timer_wheel_pop_expired(&queue->wheel, delay_queue_now(),
+                                               values, max_count);
+    pthread_mutex_unlock(&queue->lock);
+    return written;
+}
+
+unsigned delay_queue_pop_wait(struct DelayQueue *queue, uint32_t *values,
+                              unsigned max_count) {
+    assert(max_count != 0);
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        unsigned written = timer_wheel_pop_expired(
+            &queue->wheel, delay_queue_now(), values, max_count);
+        if (written != 0) {
+            pthread_mutex_unlock(&queue->lock);
+            return written;
+        }
+        uint64_t deadline;
+        if (timer_wheel_next_deadline(&queue->wheel, &deadline) == -1) {
+            pthread_cond_wait(&queue->scheduled, &queue->lock);
+            continue;
+        }
+        // Spurious and early wake-ups are fine, the wheel is simply advanced
+        // again.
+        struct timespec ts;
+        ts.tv_sec = deadline / 1000;
+        ts.tv_nsec = (deadline % 1000) * 1000000;
+        pthread_cond_timedwait(&queue->scheduled, &queue->lock, &ts);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "timer-wheel.h"
+
+/// A thread-safe queue of delayed values, built on top of a `TimerWheel` with
+/// a tick of one millisecond of the monotonic clock.
+///
+/// Consumers either collect the expired values with `delay_queue_pop_expired`,
+/// or sleep in `delay_queue_pop_wait` until the next deadline of the wheel
+/// (or until a new value is scheduled), so there's no polling involved.
+struct DelayQueue {
+    /// Protects the `wheel`.
+    pthread_mutex_t lock;
+    /// Signalled whenever a value is scheduled.
+    pthread_cond_t scheduled;
+    /// The timers.
+    struct TimerWheel wheel;
+};
+
+/// Initializes an empty delay queue.
+void delay_queue_init(struct DelayQueue *queue);
+
+/// Releases resources held by a delay queue. The queue should not be in use by
+/// any thread.
+void delay_queue_destroy(struct DelayQueue *queue);
+
+/// Returns the current time of the monotonic clock in milliseconds, i.e. in
+/// the ticks of the delay queues.
+uint64_t delay_queue_now();
+
+/// Schedules a `value` to expire after `delay_ms` milliseconds and stores its
+/// handle into the `handle` (unless it's `NULL`). Returns -1 if the value can't
+/// be scheduled (see `timer_wheel_insert`).
+int delay_queue_schedule(struct DelayQueue *queue, uint32_t value,
+                         uint64_t delay_ms, uint32_t *handle);
+
+/// Cancels a scheduled value. Returns -1 if it's not scheduled anymore.
+int delay_queue_cancel(struct DelayQueue *queue, uint32_t handle);
+
+/// Writes up to `max_count` expired values into the `values` array without
+/// blocking. Returns the number of the values written.
+unsigned delay_queue_pop_expired(struct DelayQueue *queue, uint32_t *values,
+                                 unsigned max_count);
+
+/// Same as `delay_queue_pop_expired`, but if there are no expired values, waits
+/// until at least one expires. `max_count` should not be zero.
+unsigned delay_queue_pop_wait(struct DelayQueue *queue, uint32_t *values,
+                              unsigned max_count);
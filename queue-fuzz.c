@@ -0,0 +1,796 @@
+/// Differential fuzzing and stress testing of the queues.
+///
+/// The fuzzer interprets its input as a sequence of operations, runs them
+/// against the `queue`, `cow-queue` and `timer-wheel` modules and checks the
+/// results against simple reference models after every step. Since the queue
+/// capacity is a compile-time setting, the harness should be built (and run)
+/// for a number of `QUEUE_MAX_LENGTH`s, including the degenerate ones:
+///
+/// ```
+/// $ for len in 1 2 3 5 10 64; do
+///     clang -g -fsanitize=address,undefined -DQUEUE_MAX_LENGTH=$len queue-fuzz.c queue.c cow-queue.c timer-wheel.c sharded-queue.c delay-queue.c -lpthread -oqueue-fuzz-$len &&
+///     ./queue-fuzz-$len --random 1 100000 || break;
+///   done
+/// ```
+///
+/// The concurrent modules (`sharded-queue`, `cow-queue` snapshots and
+/// `delay-queue`) are exercised by the stress mode, which is best run under
+/// the thread sanitizer:
+///
+/// ```
+/// $ clang -g -fsanitize=thread queue-fuzz.c queue.c cow-queue.c timer-wheel.c sharded-queue.c delay-queue.c -lpthread -oqueue-fuzz
+/// $ ./queue-fuzz --stress 8 100000
+/// ```
+///
+/// # Modes
+///
+/// * `queue-fuzz --random <seed> <runs>` runs `<runs>` deterministic pseudo
+///   random inputs.
+/// * `queue-fuzz --stress <threads> <iterations>` runs the multithreaded
+///   stress tests.
+/// * `queue-fuzz <files>...` replays the given inputs, e.g. crashes found by a
+///   fuzzer.
+/// * `queue-fuzz` without arguments reads a single input from the stdin, which
+///   is what AFL expects (`afl-fuzz -i seeds -o findings ./queue-fuzz`).
+///
+/// To build for libFuzzer, pass `-DQUEUE_FUZZ_LIBFUZZER -fsanitize=fuzzer` to
+/// the compiler, which drops the `main` function above. The queues report
+/// failed operations on the stderr, so `-close_fd_mask=2` is handy.
+///
+/// On successful execution the return code will be zero; some output is
+/// expected.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cow-queue.h"
+#include "delay-queue.h"
+#include "queue.h"
+#include "sharded-queue.h"
+#include "timer-wheel.h"
+
+/// Number of the queues under test.
+#define FUZZ_QUEUES 3
+
+/// Number of the copy-on-write snapshots kept around.
+#define FUZZ_SNAPSHOTS 2
+
+/// A maximum size of an input generated in the random mode.
+#define FUZZ_MAX_INPUT 4096
+
+/// Same as `assert`, but isn't compiled out with `NDEBUG`, since the checks
+/// are the whole point of the harness.
+#define FUZZ_CHECK(condition)                                            \
+    do {                                                                 \
+        if (!(condition)) {                                              \
+            fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__,       \
+                    __LINE__, #condition);                               \
+            abort();                                                     \
+        }                                                                \
+    } while (0)
+
+/// A reference model of a `Queue`: a plain array, `items[0]` being the 'back'
+/// (i.e. 'first') element.
+struct FuzzModel {
+    unsigned size;
+    uint32_t items[QUEUE_MAX_LENGTH];
+};
+
+/// How many ticks late a timer may fire, given the largest number of the
+/// scheduled timers while it's waiting (see `TimerWheel`).
+#define FUZZ_TIMER_SLACK(peak) ((peak) / QUEUE_MAX_LENGTH)
+
+/// A reference model of a scheduled timer.
+struct FuzzTimer {
+    uint32_t handle;
+    uint32_t value;
+    uint64_t due;
+    /// The largest number of the scheduled timers since this one was.
+    unsigned peak;
+};
+
+/// The whole state of a fuzzing run.
+struct FuzzState {
+    /// The queues under test and their models.
+    struct Queue queues[FUZZ_QUEUES];
+    struct FuzzModel models[FUZZ_QUEUES];
+    /// A copy-on-write mirror of `queues[0]`.
+    struct CowQueue cow;
+    /// Snapshots of the `cow` and their models.
+    struct CowQueue snapshots[FUZZ_SNAPSHOTS];
+    struct FuzzModel snapshot_models[FUZZ_SNAPSHOTS];
+
+    /// The timer wheel under test.
+    struct TimerWheel wheel;
+    /// The last tick the wheel has been advanced to.
+    uint64_t now;
+    /// The scheduled timers.
+    struct FuzzTimer timers[TIMER_WHEEL_CAPACITY];
+    unsigned timers_count;
+    /// A counter to make the timer values unique.
+    uint32_t next_timer_value;
+};
+
+/// A reader of the fuzzer input.
+struct FuzzInput {
+    const uint8_t *data;
+    size_t size;
+};
+
+/// Takes the next byte of the input, or zero if it's exhausted.
+static uint8_t fuzz_byte(struct FuzzInput *input);
+
+/// Takes the next 4 bytes of the input as a value.
+static uint32_t fuzz_u32(struct FuzzInput *input);
+
+/// Checks a queue against its model through every accessor.
+static void fuzz_check_queue(const struct Queue *queue,
+                             const struct FuzzModel *model);
+
+/// Checks a copy-on-write queue against a model.
+static void fuzz_check_cow(const struct CowQueue *queue,
+                           const struct FuzzModel *model);
+
+/// Zips a number of models into an array, returning the resulting length.
+static unsigned fuzz_model_zip(const struct FuzzModel *const *models,
+                               unsigned count, uint32_t *destination);
+
+/// Runs a single queue operation encoded by the input.
+static void fuzz_queue_step(struct FuzzState *state, struct FuzzInput *input);
+
+/// Pops the expired timers at the `now` tick in batches and checks them
+/// against the model.
+static void fuzz_timer_pop(struct FuzzState *state, unsigned batch);
+
+/// Runs a single timer wheel operation encoded by the input.
+static void fuzz_timer_step(struct FuzzState *state, struct FuzzInput *input);
+
+/// Runs a single input.
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+uint8_t fuzz_byte(struct FuzzInput *input) {
+    if (input->size == 0) {
+        return 0;
+    }
+    uint8_t byte = input->data[0];
+    input->data += 1;
+    input->size -= 1;
+    return byte;
+}
+
+uint32_t fuzz_u32(struct FuzzInput *input) {
+    uint32_t value = 0;
+    for (unsigned i = 0; i != 4; ++i) {
+        value = (value << 8) | fuzz_byte(input);
+    }
+    return value;
+}
+
+void fuzz_check_queue(const struct Queue *queue,
+                      const struct FuzzModel *model) {
+    FUZZ_CHECK(queue->size == model->size);
+    FUZZ_CHECK(queue->begin < QUEUE_MAX_LENGTH);
+    uint32_t copy[QUEUE_MAX_LENGTH];
+    queue_copy_to(queue, copy);
+    for (unsigned i = 0; i != model->size; ++i) {
+        FUZZ_CHECK(queue_get_value(queue, i) == model->items[i]);
+        FUZZ_CHECK(copy[i] == model->items[i]);
+    }
+}
+
+void fuzz_check_cow(const struct CowQueue *queue,
+                    const struct FuzzModel *model) {
+    FUZZ_CHECK(queue->size == model->size);
+    uint32_t copy[QUEUE_MAX_LENGTH];
+    cow_queue_copy_to(queue, copy);
+    for (unsigned i = 0; i != model->size; ++i) {
+        FUZZ_CHECK(cow_queue_get_value(queue, i) == model->items[i]);
+        FUZZ_CHECK(copy[i] == model->items[i]);
+    }
+}
+
+unsigned fuzz_model_zip(const struct FuzzModel *const *models, unsigned count,
+                        uint32_t *destination) {
+    unsigned written = 0;
+    for (unsigned row = 0; row != QUEUE_MAX_LENGTH; ++row) {
+        for (unsigned i = 0; i != count; ++i) {
+            if (row < models[i]->size) {
+                destination[written] = models[i]->items[row];
+                written += 1;
+            }
+        }
+    }
+    return written;
+}
+
+void fuzz_queue_step(struct FuzzState *state, struct FuzzInput *input) {
+    uint8_t op = fuzz_byte(input);
+    unsigned n = fuzz_byte(input) % FUZZ_QUEUES;
+    struct Queue *queue = &state->queues[n];
+    struct FuzzModel *model = &state->models[n];
+    // Whether the operation touched the mirrored queue, so the `cow` should
+    // follow.
+    int mirrored = (n == 0);
+    // Whether the queues have been merged. Merges have no copy-on-write
+    // counterpart, so the mirror is rebuilt afterwards.
+    int merged_queues = 0;
+
+    switch (op % 10) {
+        case 0: {
+            uint32_t value = fuzz_u32(input);
+            int rc = queue_push_back(queue, value);
+            FUZZ_CHECK(rc == (model->size == QUEUE_MAX_LENGTH ? -1 : 0));
+            if (rc == 0) {
+                memmove(model->items + 1, model->items,
+                        model->size * sizeof(uint32_t));
+                model->items[0] = value;
+                model->size += 1;
+            }
+            if (mirrored) {
+                FUZZ_CHECK(cow_queue_push_back(&state->cow, value) == rc);
+            }
+            break;
+        }
+        case 1:
+        case 2: {
+            uint32_t value = 0;
+            uint32_t cow_value = 0;
+            int back = (op % 10 == 1);
+            int rc = back ? queue_pop_back(queue, &value)
+                          : queue_pop_front(queue, &value);
+            FUZZ_CHECK(rc == (model->size == 0 ? -1 : 0));
+            if (rc == 0) {
+                unsigned index = back ? 0 : model->size - 1;
+                FUZZ_CHECK(value == model->items[index]);
+                memmove(model->items + index, model->items + index + 1,
+                        (model->size - index - 1) * sizeof(uint32_t));
+                model->size -= 1;
+            }
+            if (mirrored) {
+                struct CowQueue *cow = &state->cow;
+                int cow_rc = back ? cow_queue_pop_back(cow, &cow_value)
+                                  : cow_queue_pop_front(cow, &cow_value);
+                FUZZ_CHECK(cow_rc == rc && cow_value == value);
+            }
+            break;
+        }
+        case 3: {
+            // Look either for a present value or for a random one.
+            uint8_t selector = fuzz_byte(input);
+            uint32_t value = (selector & 1 && model->size != 0)
+                                 ? model->items[selector % model->size]
+                                 : fuzz_u32(input);
+            unsigned expected = 0;
+            while (expected != model->size && model->items[expected] != value) {
+                expected += 1;
+            }
+            unsigned index = 0;
+            int rc = queue_find(queue, value, &index);
+            FUZZ_CHECK(rc == (expected == model->size ? -1 : 0));
+            FUZZ_CHECK(rc == -1 || index == expected);
+            break;
+        }
+        case 4: {
+            if (model->size == 0) {
+                break;
+            }
+            unsigned index = fuzz_byte(input) % model->size;
+            queue_remove(queue, index);
+            memmove(model->items + index, model->items + index + 1,
+                    (model->size - index - 1) * sizeof(uint32_t));
+            model->size -= 1;
+            if (mirrored) {
+                FUZZ_CHECK(cow_queue_remove(&state->cow, index) == 0);
+            }
+            break;
+        }
+        case 5:
+        case 6: {
+            // Two queues or all of them, starting at the `n`.
+            unsigned count = (op % 10 == 5) ? 2 : FUZZ_QUEUES;
+            struct Queue *queues[FUZZ_QUEUES];
+            const struct FuzzModel *models[FUZZ_QUEUES];
+            unsigned total_len = 0;
+            for (unsigned i = 0; i != count; ++i) {
+                queues[i] = &state->queues[(n + i) % FUZZ_QUEUES];
+                models[i] = &state->models[(n + i) % FUZZ_QUEUES];
+                total_len += models[i]->size;
+            }
+            if (total_len > QUEUE_MAX_LENGTH) {
+                break;
+            }
+            struct FuzzModel merged;
+            merged.size = fuzz_model_zip(models, count, merged.items);
+            FUZZ_CHECK(merged.size == total_len);
+            if (count == 2) {
+                queue_merge(queues[0], queues[1]);
+            } else {
+                queue_merge_many(queues, count);
+            }
+            for (unsigned i = 0; i != count; ++i) {
+                state->models[(n + i) % FUZZ_QUEUES].size = 0;
+            }
+            *model = merged;
+            merged_queues = 1;
+            break;
+        }
+        case 7: {
+            // The queues are not sorted, so take sorted copies of them.
+            static struct Queue sorted[FUZZ_QUEUES];
+            const struct Queue *sorted_queues[FUZZ_QUEUES];
+            uint32_t expected[FUZZ_QUEUES * QUEUE_MAX_LENGTH];
+            unsigned total_len = 0;
+            for (unsigned i = 0; i != FUZZ_QUEUES; ++i) {
+                struct FuzzModel copy = state->models[i];
+                // Insertion sort, the models are tiny.
+                for (unsigned j = 1; j < copy.size; ++j) {
+                    for (unsigned k = j;
+                         k != 0 && copy.items[k - 1] > copy.items[k]; --k) {
+                        uint32_t tmp = copy.items[k];
+                        copy.items[k] = copy.items[k - 1];
+                        copy.items[k - 1] = tmp;
+                    }
+                }
+                queue_init(&sorted[i]);
+                for (unsigned j = copy.size; j != 0; --j) {
+                    queue_push_back(&sorted[i], copy.items[j - 1]);
+                }
+                sorted_queues[i] = &sorted[i];
+                memcpy(expected + total_len, copy.items,
+                       copy.size * sizeof(uint32_t));
+                total_len += copy.size;
+            }
+            struct QueueSortedIter iter;
+            queue_sorted_iter_init(&iter, sorted_queues, FUZZ_QUEUES);
+            unsigned batch = fuzz_byte(input) % 8 + 1;
+            uint32_t result[FUZZ_QUEUES * QUEUE_MAX_LENGTH];
+            unsigned written = 0;
+            unsigned step;
+            while ((step = queue_sorted_iter_next(&iter, result + written,
+                                                  batch)) != 0) {
+                FUZZ_CHECK(step <= batch);
+                written += step;
+            }
+            FUZZ_CHECK(written == total_len);
+            // Same multiset, and in order.
+            for (unsigned i = 0; i != written; ++i) {
+                FUZZ_CHECK(i == 0 || result[i - 1] <= result[i]);
+                unsigned j = i;
+                while (j != total_len && expected[j] != result[i]) {
+                    j += 1;
+                }
+                FUZZ_CHECK(j != total_len);
+                expected[j] = expected[i];
+                expected[i] = result[i];
+            }
+            if (total_len <= QUEUE_MAX_LENGTH) {
+                struct Queue *merge_queues[FUZZ_QUEUES];
+                for (unsigned i = 0; i != FUZZ_QUEUES; ++i) {
+                    merge_queues[i] = &sorted[i];
+                }
+                queue_merge_many_sorted(merge_queues, FUZZ_QUEUES);
+                FUZZ_CHECK(sorted[0].size == total_len);
+                for (unsigned i = 0; i != total_len; ++i) {
+                    FUZZ_CHECK(queue_get_value(&sorted[0], i) == result[i]);
+                }
+            }
+            break;
+        }
+        case 8: {
+            const struct Queue *queues[FUZZ_QUEUES];
+            const struct FuzzModel *models[FUZZ_QUEUES];
+            for (unsigned i = 0; i != FUZZ_QUEUES; ++i) {
+                queues[i] = &state->queues[(n + i) % FUZZ_QUEUES];
+                models[i] = &state->models[(n + i) % FUZZ_QUEUES];
+            }
+            uint32_t expected[FUZZ_QUEUES * QUEUE_MAX_LENGTH];
+            unsigned total_len = fuzz_model_zip(models, FUZZ_QUEUES, expected);
+            struct QueueZipIter iter;
+            queue_zip_iter_init(&iter, queues, FUZZ_QUEUES);
+            unsigned batch = fuzz_byte(input) % 8 + 1;
+            uint32_t result[FUZZ_QUEUES * QUEUE_MAX_LENGTH];
+            unsigned written = 0;
+            unsigned step;
+            while ((step = queue_zip_iter_next(&iter, result + written,
+                                               batch)) != 0) {
+                FUZZ_CHECK(step <= batch);
+                written += step;
+            }
+            FUZZ_CHECK(written == total_len);
+            FUZZ_CHECK(memcmp(result, expected,
+                              total_len * sizeof(uint32_t)) == 0);
+            break;
+        }
+        case 9: {
+            unsigned k = n % FUZZ_SNAPSHOTS;
+            cow_queue_destroy(&state->snapshots[k]);
+            cow_queue_clone(&state->snapshots[k], &state->cow);
+            state->snapshot_models[k] = state->models[0];
+            break;
+        }
+    }
+
+    if (merged_queues) {
+        cow_queue_destroy(&state->cow);
+        FUZZ_CHECK(cow_queue_from_queue(&state->cow, &state->queues[0]) == 0);
+    }
+    for (unsigned i = 0; i != FUZZ_QUEUES; ++i) {
+        fuzz_check_queue(&state->queues[i], &state->models[i]);
+    }
+    fuzz_check_cow(&state->cow, &state->models[0]);
+    for (unsigned i = 0; i != FUZZ_SNAPSHOTS; ++i) {
+        fuzz_check_cow(&state->snapshots[i], &state->snapshot_models[i]);
+    }
+}
+
+void fuzz_timer_pop(struct FuzzState *state, unsigned batch) {
+    uint32_t values[8];
+    unsigned count;
+    while ((count = timer_wheel_pop_expired(&state->wheel, state->now, values,
+                                            batch)) != 0) {
+        for (unsigned i = 0; i != count; ++i) {
+            // Each value fires once, never before its due time.
+            unsigned index = 0;
+            while (index != state->timers_count &&
+                   state->timers[index].value != values[i]) {
+                index += 1;
+            }
+            FUZZ_CHECK(index != state->timers_count);
+            FUZZ_CHECK(state->timers[index].due <= state->now);
+            state->timers_count -= 1;
+            state->timers[index] = state->timers[state->timers_count];
+        }
+    }
+    // ... and not too late either.
+    for (unsigned i = 0; i != state->timers_count; ++i) {
+        const struct FuzzTimer *timer = &state->timers[i];
+        FUZZ_CHECK(timer->due + FUZZ_TIMER_SLACK(timer->peak) > state->now);
+    }
+}
+
+void fuzz_timer_step(struct FuzzState *state, struct FuzzInput *input) {
+    uint8_t op = fuzz_byte(input);
+    // Insertions go twice as often, so the timers pile up.
+    switch (op % 4) {
+        case 0:
+        case 3: {
+            // Mostly near deadlines, sometimes far beyond the wheel span, and
+            // sometimes due right now or overdue.
+            uint32_t delay = fuzz_u32(input);
+            uint64_t due;
+            if (delay & 0x80000000) {
+                due = state->now + (delay >> 8);
+            } else if (delay & 0x40000000) {
+                uint64_t overdue = delay % 4;
+                due = (overdue <= state->now) ? state->now - overdue : 0;
+            } else if (delay & 0x20000000) {
+                // Deadlines on a coarse grid make the buckets overflow, both
+                // for the timers inserted together and the ones cascaded from
+                // higher levels.
+                due = (state->now + delay % 300) | 0x1f;
+            } else if (delay & 0x10000000) {
+                // A pile of timers due at the same couple of ticks.
+                due = state->now + delay % 2;
+            } else {
+                due = state->now + delay % 300;
+            }
+            uint32_t value = state->next_timer_value++;
+            uint32_t handle;
+            if (timer_wheel_insert(&state->wheel, value, due, &handle) != 0) {
+                FUZZ_CHECK(state->timers_count == TIMER_WHEEL_CAPACITY);
+                break;
+            }
+            FUZZ_CHECK(state->timers_count != TIMER_WHEEL_CAPACITY);
+            struct FuzzTimer *timer = &state->timers[state->timers_count];
+            timer->handle = handle;
+            timer->value = value;
+            timer->due = due;
+            timer->peak = 0;
+            state->timers_count += 1;
+            for (unsigned i = 0; i != state->timers_count; ++i) {
+                if (state->timers[i].peak < state->timers_count) {
+                    state->timers[i].peak = state->timers_count;
+                }
+            }
+            if (due <= state->now) {
+                // An expired timer comes out without advancing the wheel.
+                fuzz_timer_pop(state, fuzz_byte(input) % 8 + 1);
+                for (unsigned i = 0; i != state->timers_count; ++i) {
+                    FUZZ_CHECK(state->timers[i].value != value);
+                }
+            }
+            break;
+        }
+        case 1: {
+            if (state->timers_count == 0) {
+                FUZZ_CHECK(timer_wheel_cancel(&state->wheel, 0) == -1);
+                break;
+            }
+            unsigned index = fuzz_byte(input) % state->timers_count;
+            FUZZ_CHECK(timer_wheel_cancel(&state->wheel,
+                                          state->timers[index].handle) == 0);
+            FUZZ_CHECK(timer_wheel_cancel(&state->wheel,
+                                          state->timers[index].handle) == -1);
+            state->timers_count -= 1;
+            state->timers[index] = state->timers[state->timers_count];
+            break;
+        }
+        case 2: {
+            uint8_t step = fuzz_byte(input);
+            if (step & 0x80) {
+                state->now += (uint64_t)(step & 0x7f) << 8;
+            } else {
+                // Small steps catch the timers which are late.
+                state->now += (step & 0x40) ? step & 3 : step;
+            }
+            fuzz_timer_pop(state, fuzz_byte(input) % 8 + 1);
+            break;
+        }
+    }
+    FUZZ_CHECK(state->wheel.count == state->timers_count);
+    uint64_t deadline;
+    int rc = timer_wheel_next_deadline(&state->wheel, &deadline);
+    FUZZ_CHECK(rc == (state->timers_count == 0 ? -1 : 0));
+    for (unsigned i = 0; rc == 0 && i != state->timers_count; ++i) {
+        // The wheel wakes up no later than the earliest timer might fire.
+        const struct FuzzTimer *timer = &state->timers[i];
+        FUZZ_CHECK(deadline <= timer->due + FUZZ_TIMER_SLACK(timer->peak));
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // The state is too big for the stack.
+    static struct FuzzState state;
+    struct FuzzInput input = {data, size};
+    for (unsigned i = 0; i != FUZZ_QUEUES; ++i) {
+        queue_init(&state.queues[i]);
+        state.models[i].size = 0;
+    }
+    cow_queue_init(&state.cow);
+    for (unsigned i = 0; i != FUZZ_SNAPSHOTS; ++i) {
+        cow_queue_init(&state.snapshots[i]);
+        state.snapshot_models[i].size = 0;
+    }
+    state.now = fuzz_u32(&input);
+    timer_wheel_init(&state.wheel, state.now);
+    state.timers_count = 0;
+    state.next_timer_value = 0;
+
+    while (input.size != 0) {
+        if (fuzz_byte(&input) & 1) {
+            fuzz_timer_step(&state, &input);
+        } else {
+            fuzz_queue_step(&state, &input);
+        }
+    }
+
+    cow_queue_destroy(&state.cow);
+    for (unsigned i = 0; i != FUZZ_SNAPSHOTS; ++i) {
+        cow_queue_destroy(&state.snapshots[i]);
+    }
+    return 0;
+}
+
+#ifndef QUEUE_FUZZ_LIBFUZZER
+
+/// Arguments of a stress thread.
+struct StressArgs {
+    /// Number of the thread.
+    unsigned id;
+    /// Number of the iterations to perform.
+    unsigned iterations;
+    /// Shared structures under test.
+    struct ShardedQueue *sharded;
+    pthread_mutex_t *cow_lock;
+    struct CowQueue *cow;
+    struct DelayQueue *delay;
+    /// Number of the values this thread has pushed to the `sharded` queue
+    /// and popped out of it.
+    unsigned long pushed;
+    unsigned long popped;
+    /// Sum of the values this thread has pushed to the `sharded` queue and
+    /// popped out of it.
+    unsigned long long pushed_sum;
+    unsigned long long popped_sum;
+    /// Number of the values this thread has got out of the `delay` queue.
+    unsigned long expired;
+};
+
+/// A xorshift pseudo random generator, so the runs don't depend on the libc.
+static uint32_t fuzz_random(uint32_t *state);
+
+/// Hammers the shared structures from a thread.
+static void *stress_thread(void *arg);
+
+/// Runs the stress mode.
+static int stress_run(unsigned threads, unsigned iterations);
+
+/// Runs a single input out of a file (or the stdin if `file_name` is `NULL`).
+static int fuzz_run_file(const char *file_name);
+
+uint32_t fuzz_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void *stress_thread(void *arg) {
+    struct StressArgs *args = arg;
+    uint32_t random = args->id * 2654435761u + 1;
+    for (unsigned i = 0; i != args->iterations; ++i) {
+        uint32_t choice = fuzz_random(&random) % 8;
+        if (choice < 3) {
+            // The values are unique per thread, and sum up the same way no
+            // matter who pops them.
+            uint32_t value = (args->id << 24) | (i & 0xffffff);
+            if (sharded_queue_push(args->sharded, value) == 0) {
+                args->pushed += 1;
+                args->pushed_sum += value;
+            }
+        } else if (choice < 6) {
+            uint32_t value;
+            if (sharded_queue_pop(args->sharded, &value) == 0) {
+                args->popped += 1;
+                args->popped_sum += value;
+            }
+        } else if (choice == 6) {
+            // Take a snapshot and scan it while the others keep on writing
+            // to the original.
+            struct CowQueue snapshot;
+            pthread_mutex_lock(args->cow_lock);
+            uint32_t value;
+            if (args->cow->size == QUEUE_MAX_LENGTH) {
+                cow_queue_pop_front(args->cow, &value);
+            }
+            FUZZ_CHECK(cow_queue_push_back(args->cow, i) == 0);
+            cow_queue_clone(&snapshot, args->cow);
+            pthread_mutex_unlock(args->cow_lock);
+            uint32_t first[QUEUE_MAX_LENGTH];
+            uint32_t second[QUEUE_MAX_LENGTH];
+            cow_queue_copy_to(&snapshot, first);
+            sched_yield();
+            cow_queue_copy_to(&snapshot, second);
+            FUZZ_CHECK(memcmp(first, second,
+                              snapshot.size * sizeof(uint32_t)) == 0);
+            FUZZ_CHECK(first[0] == i);
+            cow_queue_destroy(&snapshot);
+        } else {
+            if (fuzz_random(&random) % 2 == 0) {
+                delay_queue_schedule(args->delay, i, fuzz_random(&random) % 3,
+                                     NULL);
+            } else {
+                uint32_t values[4];
+                args->expired += delay_queue_pop_expired(args->delay, values,
+                                                         4);
+            }
+        }
+    }
+    return NULL;
+}
+
+int stress_run(unsigned threads, unsigned iterations) {
+    static struct ShardedQueue sharded;
+    static struct DelayQueue delay;
+    pthread_mutex_t cow_lock;
+    struct CowQueue cow;
+    sharded_queue_init(&sharded, 0);
+    delay_queue_init(&delay);
+    pthread_mutex_init(&cow_lock, NULL);
+    cow_queue_init(&cow);
+
+    pthread_t *handles = malloc(threads * sizeof(pthread_t));
+    struct StressArgs *args = calloc(threads, sizeof(struct StressArgs));
+    for (unsigned i = 0; i != threads; ++i) {
+        args[i].id = i;
+        args[i].iterations = iterations;
+        args[i].sharded = &sharded;
+        args[i].cow_lock = &cow_lock;
+        args[i].cow = &cow;
+        args[i].delay = &delay;
+        FUZZ_CHECK(pthread_create(&handles[i], NULL, stress_thread, &args[i]) ==
+                   0);
+    }
+    unsigned long pushed = 0, popped = 0;
+    unsigned long long pushed_sum = 0, popped_sum = 0;
+    for (unsigned i = 0; i != threads; ++i) {
+        pthread_join(handles[i], NULL);
+        pushed += args[i].pushed;
+        popped += args[i].popped;
+        pushed_sum += args[i].pushed_sum;
+        popped_sum += args[i].popped_sum;
+    }
+
+    // Nothing is lost or duplicated by the sharded queue.
+    FUZZ_CHECK(sharded_queue_size(&sharded) == pushed - popped);
+    uint32_t value;
+    while (sharded_queue_pop(&sharded, &value) == 0) {
+        popped += 1;
+        popped_sum += value;
+    }
+    FUZZ_CHECK(pushed == popped);
+    FUZZ_CHECK(pushed_sum == popped_sum);
+
+    // Everything scheduled eventually expires.
+    unsigned long expired = 0;
+    for (unsigned i = 0; i != threads; ++i) {
+        expired += args[i].expired;
+    }
+    pthread_mutex_lock(&delay.lock);
+    unsigned remaining = delay.wheel.count;
+    pthread_mutex_unlock(&delay.lock);
+    while (remaining != 0) {
+        uint32_t values[16];
+        unsigned count = delay_queue_pop_wait(&delay, values, 16);
+        FUZZ_CHECK(count <= remaining);
+        remaining -= count;
+        expired += count;
+    }
+    printf("stress: %u threads, %lu pushed/popped, %lu expired\n", threads,
+           pushed, expired);
+
+    free(args);
+    free(handles);
+    cow_queue_destroy(&cow);
+    pthread_mutex_destroy(&cow_lock);
+    delay_queue_destroy(&delay);
+    sharded_queue_destroy(&sharded);
+    return 0;
+}
+
+int fuzz_run_file(const char *file_name) {
+    FILE *f = (file_name == NULL) ? stdin : fopen(file_name, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Can't open [%s]\n", file_name);
+        return -1;
+    }
+    static uint8_t data[1 << 20];
+    size_t size = fread(data, 1, sizeof(data), f);
+    if (f != stdin) {
+        fclose(f);
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 1) {
+        return fuzz_run_file(NULL) == 0 ? 0 : 1;
+    }
+    if (strcmp(argv[1], "--random") == 0 && argc == 4) {
+        uint32_t random = strtoul(argv[2], NULL, 0) | 1;
+        unsigned long runs = strtoul(argv[3], NULL, 0);
+        static uint8_t data[FUZZ_MAX_INPUT];
+        for (unsigned long run = 0; run != runs; ++run) {
+            size_t size = fuzz_random(&random) % FUZZ_MAX_INPUT;
+            for (size_t i = 0; i != size; ++i) {
+                data[i] = fuzz_random(&random);
+            }
+            LLVMFuzzerTestOneInput(data, size);
+        }
+        printf("random: %lu runs\n", runs);
+        return 0;
+    }
+    if (strcmp(argv[1], "--stress") == 0 && argc == 4) {
+        unsigned threads = strtoul(argv[2], NULL, 0);
+        unsigned iterations = strtoul(argv[3], NULL, 0);
+        if (threads == 0) {
+            fprintf(stderr, "Number of threads should be positive\n");
+            return 1;
+        }
+        return stress_run(threads, iterations) == 0 ? 0 : 1;
+    }
+    for (int i = 1; i != argc; ++i) {
+        if (fuzz_run_file(argv[i]) == -1) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif  // QUEUE_FUZZ_LIBFUZZER
@@ -169,6 +169,111 @@ static void test_merge() {
     assert(queue2.size == 0);
 }
 
+static void test_merge_many() {
+    struct Queue queue1, queue2, queue3;
+    uint32_t initial1[] = {1, 4};
+    uint32_t initial2[] = {2};
+    uint32_t initial3[] = {3, 5};
+    make_initial2(&queue1, initial1, 2);
+    make_initial2(&queue2, initial2, 1);
+    make_initial2(&queue3, initial3, 2);
+    // Make the first queue wrap around the end of the array.
+    queue1.begin = 4;
+    queue1.array[4] = 1;
+    queue1.array[0] = 4;
+
+    struct Queue* queues[] = {&queue1, &queue2, &queue3};
+    queue_merge_many(queues, 3);
+    {
+        uint32_t reference_array[] = {1, 2, 3, 4, 5};
+        CHECK_QUEUE(&queue1, reference_array);
+    }
+    assert(queue2.size == 0);
+    assert(queue3.size == 0);
+}
+
+static void test_merge_many_sorted() {
+    struct Queue queue1, queue2, queue3;
+    uint32_t initial1[] = {2, 7};
+    uint32_t initial2[] = {1, 2};
+    uint32_t initial3[] = {5};
+    make_initial2(&queue1, initial1, 2);
+    make_initial2(&queue2, initial2, 2);
+    make_initial2(&queue3, initial3, 1);
+
+    struct Queue* queues[] = {&queue1, &queue2, &queue3};
+    queue_merge_many_sorted(queues, 3);
+    {
+        uint32_t reference_array[] = {1, 2, 2, 5, 7};
+        CHECK_QUEUE(&queue1, reference_array);
+    }
+    assert(queue2.size == 0);
+    assert(queue3.size == 0);
+}
+
+static void test_zip_iter() {
+    // The combined size is well over `QUEUE_MAX_LENGTH`.
+    struct Queue queue1, queue2, queue3;
+    uint32_t initial1[] = {1, 4, 7, 9, 11};
+    uint32_t initial2[] = {2, 5};
+    uint32_t initial3[] = {3, 6, 8, 10};
+    make_initial2(&queue1, initial1, 5);
+    make_initial2(&queue2, initial2, 2);
+    make_initial2(&queue3, initial3, 4);
+
+    const struct Queue* queues[] = {&queue1, &queue2, &queue3};
+    struct QueueZipIter iter;
+    queue_zip_iter_init(&iter, queues, 3);
+    uint32_t result[11];
+    unsigned total = 0;
+    unsigned written;
+    while ((written = queue_zip_iter_next(&iter, result + total, 3)) != 0) {
+        assert(written <= 3);
+        total += written;
+    }
+    assert(total == 11);
+    for (unsigned i = 0; i != total; ++i) {
+        assert(result[i] == i + 1);
+    }
+    // The queues are left intact.
+    assert(queue1.size == 5 && queue2.size == 2 && queue3.size == 4);
+}
+
+static void test_sorted_iter() {
+    struct Queue queues_storage[7];
+    const struct Queue* queues[7];
+    // Queue `i` holds multiples of `i + 1`, so there are plenty of duplicates.
+    for (unsigned i = 0; i != 7; ++i) {
+        queue_init(&queues_storage[i]);
+        for (uint32_t j = 5; j != 0; --j) {
+            assert(queue_push_back(&queues_storage[i], j * (i + 1)) == 0);
+        }
+        queues[i] = &queues_storage[i];
+    }
+    queue_init(&queues_storage[3]);
+
+    struct QueueSortedIter iter;
+    queue_sorted_iter_init(&iter, queues, 7);
+    uint32_t result[30];
+    unsigned total = 0;
+    unsigned written;
+    while ((written = queue_sorted_iter_next(&iter, result + total, 4)) != 0) {
+        total += written;
+    }
+    assert(total == 30);
+    for (unsigned i = 1; i != total; ++i) {
+        assert(result[i - 1] <= result[i]);
+    }
+    assert(result[0] == 1 && result[total - 1] == 35);
+
+    // Edge cases: no queues at all and a single queue.
+    queue_sorted_iter_init(&iter, queues, 0);
+    assert(queue_sorted_iter_next(&iter, result, 4) == 0);
+    queue_sorted_iter_init(&iter, queues, 1);
+    assert(queue_sorted_iter_next(&iter, result, 30) == 5);
+    assert(result[0] == 1 && result[4] == 5);
+}
+
 int main(int argc, char** argv) {
     (void)argc;
     (void)argv;
@@ -178,4 +283,8 @@ int main(int argc, char** argv) {
     test_find();
     test_remove();
     test_merge();
+    test_merge_many();
+    test_merge_many_sorted();
+    test_zip_iter();
+    test_sorted_iter();
 }
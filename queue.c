@@ -76,26 +76,179 @@ void queue_remove(struct Queue *queue, unsigned index) {
     }
 }
 
+/// Tells whether the head of the queue number `a` should go before the head of
+/// the queue number `b` in a sorted merge. Exhausted queues go after anything
+/// else, and equal heads are ordered by the queue numbers.
+static int queue_sorted_iter_less(const struct QueueSortedIter *iter,
+                                  unsigned a, unsigned b);
+
+/// Replays the matches on the path from a leaf of the queue number `source`
+/// to the root of the loser tree, after the head of that queue has changed.
+static void queue_sorted_iter_replay(struct QueueSortedIter *iter,
+                                     unsigned source);
+
+/// Stores `total_len` merged elements into the first queue and empties the rest
+/// of the queues.
+static void queue_merge_collect(struct Queue *const *queues, unsigned count,
+                                uint32_t *merged, unsigned total_len);
+
 void queue_merge(struct Queue *queue_into, struct Queue *queue2) {
-    unsigned total_len = queue_into->size + queue2->size;
+    struct Queue *queues[] = {queue_into, queue2};
+    queue_merge_many(queues, 2);
+}
+
+void queue_merge_many(struct Queue *const *queues, unsigned count) {
+    assert(count != 0);
+    unsigned total_len = 0;
+    for (unsigned i = 0; i != count; ++i) {
+        total_len += queues[i]->size;
+    }
     assert(total_len <= QUEUE_MAX_LENGTH);
-    const struct Queue *min_queue =
-        (queue_into->size < queue2->size) ? queue_into : queue2;
-    const struct Queue *max_queue =
-        (queue_into->size >= queue2->size) ? queue_into : queue2;
-    uint32_t *new_queue_array = malloc(total_len);
-    for (unsigned i = 0; i != min_queue->size; ++i) {
-        new_queue_array[2 * i] = queue_get_value(queue_into, i);
-        new_queue_array[2 * i + 1] = queue_get_value(queue2, i);
-    }
-    for (unsigned i = min_queue->size; i != max_queue->size; ++i) {
-        new_queue_array[min_queue->size + i] = queue_get_value(max_queue, i);
-    }
-    queue_into->begin = 0;
-    queue_into->size = total_len;
-    memcpy(queue_into->array, new_queue_array, total_len * sizeof(uint32_t));
-    queue2->size = 0;
-    free(new_queue_array);
+    uint32_t merged[QUEUE_MAX_LENGTH];
+    struct QueueZipIter iter;
+    queue_zip_iter_init(&iter, (const struct Queue *const *)queues, count);
+    queue_zip_iter_next(&iter, merged, total_len);
+    queue_merge_collect(queues, count, merged, total_len);
+}
+
+void queue_merge_many_sorted(struct Queue *const *queues, unsigned count) {
+    assert(count != 0);
+    unsigned total_len = 0;
+    for (unsigned i = 0; i != count; ++i) {
+        total_len += queues[i]->size;
+    }
+    assert(total_len <= QUEUE_MAX_LENGTH);
+    uint32_t merged[QUEUE_MAX_LENGTH];
+    struct QueueSortedIter iter;
+    queue_sorted_iter_init(&iter, (const struct Queue *const *)queues, count);
+    queue_sorted_iter_next(&iter, merged, total_len);
+    queue_merge_collect(queues, count, merged, total_len);
+}
+
+void queue_merge_collect(struct Queue *const *queues, unsigned count,
+                         uint32_t *merged, unsigned total_len) {
+    queues[0]->begin = 0;
+    queues[0]->size = total_len;
+    memcpy(queues[0]->array, merged, total_len * sizeof(uint32_t));
+    for (unsigned i = 1; i != count; ++i) {
+        queues[i]->size = 0;
+    }
+}
+
+void queue_zip_iter_init(struct QueueZipIter *iter,
+                         const struct Queue *const *queues, unsigned count) {
+    iter->queues = queues;
+    iter->count = count;
+    iter->row = 0;
+    iter->column = 0;
+    iter->rows = 0;
+    for (unsigned i = 0; i != count; ++i) {
+        iter->rows = MAX(iter->rows, queues[i]->size);
+    }
+}
+
+unsigned queue_zip_iter_next(struct QueueZipIter *iter, uint32_t *destination,
+                             unsigned max_count) {
+    unsigned written = 0;
+    while (written != max_count && iter->row != iter->rows) {
+        const struct Queue *queue = iter->queues[iter->column];
+        if (iter->row < queue->size) {
+            destination[written] = queue_get_value(queue, iter->row);
+            written += 1;
+        }
+        iter->column += 1;
+        if (iter->column == iter->count) {
+            iter->column = 0;
+            iter->row += 1;
+        }
+    }
+    return written;
+}
+
+int queue_sorted_iter_less(const struct QueueSortedIter *iter, unsigned a,
+                           unsigned b) {
+    const struct Queue *queue_a = iter->queues[a];
+    const struct Queue *queue_b = iter->queues[b];
+    if (iter->positions[a] == queue_a->size) {
+        return 0;
+    }
+    if (iter->positions[b] == queue_b->size) {
+        return 1;
+    }
+    uint32_t value_a = queue_get_value(queue_a, iter->positions[a]);
+    uint32_t value_b = queue_get_value(queue_b, iter->positions[b]);
+    if (value_a != value_b) {
+        return value_a < value_b;
+    }
+    return a < b;
+}
+
+void queue_sorted_iter_replay(struct QueueSortedIter *iter, unsigned source) {
+    // The leaf of the queue `i` is the node `count + i`, and the parent of the
+    // node `n` is `n / 2`. The winner of each match goes up, while the loser
+    // stays in the node.
+    unsigned winner = source;
+    for (unsigned node = (iter->count + source) / 2; node != 0; node /= 2) {
+        if (queue_sorted_iter_less(iter, iter->tree[node], winner)) {
+            unsigned loser = winner;
+            winner = iter->tree[node];
+            iter->tree[node] = loser;
+        }
+    }
+    iter->tree[0] = winner;
+}
+
+void queue_sorted_iter_init(struct QueueSortedIter *iter,
+                            const struct Queue *const *queues, unsigned count) {
+    assert(count <= QUEUE_MERGE_MAX_WAYS);
+    iter->queues = queues;
+    iter->count = count;
+    iter->tree[0] = 0;
+    for (unsigned i = 0; i != count; ++i) {
+        iter->positions[i] = 0;
+    }
+    if (count < 2) {
+        return;
+    }
+    // Play all the matches bottom-up, keeping the winners of the internal
+    // nodes aside.
+    unsigned winners[2 * QUEUE_MERGE_MAX_WAYS];
+    for (unsigned i = 0; i != count; ++i) {
+        winners[count + i] = i;
+    }
+    for (unsigned node = count - 1; node != 0; --node) {
+        unsigned left = winners[2 * node];
+        unsigned right = winners[2 * node + 1];
+        if (queue_sorted_iter_less(iter, left, right)) {
+            winners[node] = left;
+            iter->tree[node] = right;
+        } else {
+            winners[node] = right;
+            iter->tree[node] = left;
+        }
+    }
+    iter->tree[0] = winners[1];
+}
+
+unsigned queue_sorted_iter_next(struct QueueSortedIter *iter,
+                                uint32_t *destination, unsigned max_count) {
+    unsigned written = 0;
+    if (iter->count == 0) {
+        return 0;
+    }
+    while (written != max_count) {
+        unsigned source = iter->tree[0];
+        const struct Queue *queue = iter->queues[source];
+        if (iter->positions[source] == queue->size) {
+            // The best queue is exhausted, hence all of them are.
+            break;
+        }
+        destination[written] = queue_get_value(queue, iter->positions[source]);
+        written += 1;
+        iter->positions[source] += 1;
+        queue_sorted_iter_replay(iter, source);
+    }
+    return written;
 }
 
 uint32_t queue_get_value(const struct Queue *queue, unsigned index) {
@@ -55,11 +55,90 @@ int queue_find(const struct Queue *queue, uint32_t value, unsigned *index);
 /// bounds of the queue.
 void queue_remove(struct Queue *queue, unsigned index);
 
+/// Lazily yields elements of a number of queues in a zipper order: the first
+/// elements of all the queues, then the second ones and so on. Queues which
+/// run out of elements are skipped.
+///
+/// ```
+/// queues[0]: 1 4 6
+/// queues[1]: 2 5
+/// queues[2]: 3
+/// yields:    1 2 3 4 5 6
+/// ```
+///
+/// The iterator doesn't allocate and doesn't copy the queues, so they should
+/// not be modified while it is in use.
+struct QueueZipIter {
+    /// The queues being iterated over.
+    const struct Queue *const *queues;
+    /// Number of the queues.
+    unsigned count;
+    /// Number of the current row, i.e. the index within the queues.
+    unsigned row;
+    /// Number of the queue to be visited next within the current row.
+    unsigned column;
+    /// Size of the longest queue, i.e. the number of rows.
+    unsigned rows;
+};
+
+/// Yields elements of a number of sorted (in ascending order) queues in a
+/// sorted order. Equal elements come in the order of the queues they belong
+/// to.
+///
+/// The smallest head is selected with a loser (tournament) tree, so each
+/// element costs `log2(count)` comparisons. The tree is stored in the iterator
+/// itself, thus at most `QUEUE_MERGE_MAX_WAYS` queues can be merged at once.
+///
+/// The queues should not be modified while the iterator is in use.
+struct QueueSortedIter {
+    /// The queues being merged.
+    const struct Queue *const *queues;
+    /// Number of the queues.
+    unsigned count;
+    /// Index of the next element of every queue.
+    unsigned positions[QUEUE_MERGE_MAX_WAYS];
+    /// The loser tree: `tree[0]` holds the number of the queue with the
+    /// smallest head, and `tree[1]` to `tree[count - 1]` hold the losers of
+    /// the internal matches. The leaves are implicit.
+    unsigned tree[QUEUE_MERGE_MAX_WAYS];
+};
+
 /// Merges two queues into the first one. Their combined size should not be
 /// greater than `QUEUE_MAX_LENGTH`. The second queue will be emptied after the
 /// merge.
 void queue_merge(struct Queue *queue_into, struct Queue *queue2);
 
+/// Merges a number of queues into the first one in a zipper order (see
+/// `QueueZipIter`), so `queue_merge(a, b)` is the same as merging `{a, b}`.
+/// Their combined size should not be greater than `QUEUE_MAX_LENGTH`. All the
+/// queues but the first one will be emptied after the merge.
+void queue_merge_many(struct Queue *const *queues, unsigned count);
+
+/// Merges a number of sorted queues into the first one in a sorted order (see
+/// `QueueSortedIter`). Their combined size should not be greater than
+/// `QUEUE_MAX_LENGTH`. All the queues but the first one will be emptied after
+/// the merge.
+void queue_merge_many_sorted(struct Queue *const *queues, unsigned count);
+
+/// Initializes a zipper iterator over `count` queues.
+void queue_zip_iter_init(struct QueueZipIter *iter,
+                         const struct Queue *const *queues, unsigned count);
+
+/// Writes up to `max_count` next elements into the `destination` array and
+/// returns the number of elements written. Zero means the iteration is over.
+unsigned queue_zip_iter_next(struct QueueZipIter *iter, uint32_t *destination,
+                             unsigned max_count);
+
+/// Initializes a sorted merge iterator over `count` queues. The `count` should
+/// not be greater than `QUEUE_MERGE_MAX_WAYS`.
+void queue_sorted_iter_init(struct QueueSortedIter *iter,
+                            const struct Queue *const *queues, unsigned count);
+
+/// Writes up to `max_count` next elements into the `destination` array and
+/// returns the number of elements written. Zero means the iteration is over.
+unsigned queue_sorted_iter_next(struct QueueSortedIter *iter,
+                                uint32_t *destination, unsigned max_count);
+
 /// Returns a value stored at a given index. Index should lie within the bounds
 /// of the queue.
 uint32_t queue_get_value(const struct Queue *queue, unsigned index);
@@ -0,0 +1,153 @@
+/// Throughput benchmark of the `sharded-queue` module against a single `Queue`
+/// guarded by a mutex.
+///
+/// Every thread does a number of push-pop pairs, and the total number of
+/// operations per second is reported for both kinds of the queue. The queues
+/// should be large enough to hold an element per thread, so build the
+/// benchmark with an increased `QUEUE_MAX_LENGTH` and optimizations on:
+///
+/// ```
+/// $ clang -O2 -DQUEUE_MAX_LENGTH=1024 sharded-queue-bench.c sharded-queue.c queue.c -lpthread -osharded-queue-bench
+/// ```
+///
+/// ... and then run it, optionally passing a number of threads and a number of
+/// push-pop pairs per thread:
+///
+/// ```
+/// $ ./sharded-queue-bench [<threads>] [<iterations>]
+/// ```
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "queue.h"
+#include "sharded-queue.h"
+
+/// A maximum number of the benchmark threads.
+#define BENCH_MAX_THREADS 256
+
+/// A single queue guarded by a mutex, the baseline.
+struct LockedQueue {
+    pthread_mutex_t lock;
+    struct Queue queue;
+};
+
+/// Arguments of a benchmark thread.
+struct BenchArgs {
+    /// The queue under test: either `LockedQueue` or `ShardedQueue`.
+    void *queue;
+    /// Number of push-pop pairs to perform.
+    unsigned long iterations;
+    /// Number of the failed operations.
+    unsigned long failures;
+};
+
+/// Returns the current monotonic time in seconds.
+static double bench_now();
+
+/// A benchmark thread for the `LockedQueue`.
+static void *bench_locked(void *arg);
+
+/// A benchmark thread for the `ShardedQueue`.
+static void *bench_sharded(void *arg);
+
+/// Runs `threads` threads of the `routine` against the `queue` and prints out
+/// the resulting throughput.
+static void bench_run(const char *name, void *(*routine)(void *), void *queue,
+                      unsigned threads, unsigned long iterations);
+
+double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void *bench_locked(void *arg) {
+    struct BenchArgs *args = arg;
+    struct LockedQueue *queue = args->queue;
+    for (unsigned long i = 0; i != args->iterations; ++i) {
+        uint32_t value = i;
+        pthread_mutex_lock(&queue->lock);
+        if (queue->queue.size == QUEUE_MAX_LENGTH) {
+            args->failures += 1;
+        } else {
+            queue_push_back(&queue->queue, value);
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        pthread_mutex_lock(&queue->lock);
+        if (queue->queue.size == 0) {
+            args->failures += 1;
+        } else {
+            queue_pop_front(&queue->queue, &value);
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+void *bench_sharded(void *arg) {
+    struct BenchArgs *args = arg;
+    struct ShardedQueue *queue = args->queue;
+    for (unsigned long i = 0; i != args->iterations; ++i) {
+        uint32_t value = i;
+        if (sharded_queue_push(queue, value) == -1) {
+            args->failures += 1;
+        }
+        if (sharded_queue_pop(queue, &value) == -1) {
+            args->failures += 1;
+        }
+    }
+    return NULL;
+}
+
+void bench_run(const char *name, void *(*routine)(void *), void *queue,
+               unsigned threads, unsigned long iterations) {
+    pthread_t handles[BENCH_MAX_THREADS];
+    struct BenchArgs args[BENCH_MAX_THREADS];
+    double start = bench_now();
+    for (unsigned i = 0; i != threads; ++i) {
+        args[i].queue = queue;
+        args[i].iterations = iterations;
+        args[i].failures = 0;
+        pthread_create(&handles[i], NULL, routine, &args[i]);
+    }
+    unsigned long failures = 0;
+    for (unsigned i = 0; i != threads; ++i) {
+        pthread_join(handles[i], NULL);
+        failures += args[i].failures;
+    }
+    double elapsed = bench_now() - start;
+    double ops = 2.0 * threads * iterations;
+    printf("%-8s threads: %3u  ops: %10.0f  time: %7.3fs  Mops/s: %8.3f  "
+           "failed: %lu\n",
+           name, threads, ops, elapsed, ops / elapsed * 1e-6, failures);
+}
+
+int main(int argc, char **argv) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = (argc > 1) ? strtoul(argv[1], NULL, 0)
+                                  : (cpus > 0 ? (unsigned)cpus : 1);
+    unsigned long iterations =
+        (argc > 2) ? strtoul(argv[2], NULL, 0) : 1000000;
+    if (threads == 0 || threads > BENCH_MAX_THREADS) {
+        fprintf(stderr, "Number of threads should be between 1 and %i\n",
+                BENCH_MAX_THREADS);
+        return 1;
+    }
+
+    static struct LockedQueue locked;
+    pthread_mutex_init(&locked.lock, NULL);
+    queue_init(&locked.queue);
+    bench_run("locked", bench_locked, &locked, threads, iterations);
+    pthread_mutex_destroy(&locked.lock);
+
+    static struct ShardedQueue sharded;
+    sharded_queue_init(&sharded, 0);
+    bench_run("sharded", bench_sharded, &sharded, threads, iterations);
+    sharded_queue_destroy(&sharded);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/// Testing the `sharded-queue` module.
+///
+/// To run the tests, first compile this file with the `sharded-queue.c` and
+/// `queue.c`, while passing a `-DQUEUE_MAX_LENGTH=5` flag to the compiler:
+///
+/// ```
+/// $ clang -DQUEUE_MAX_LENGTH=5 sharded-queue-test.c sharded-queue.c queue.c -lpthread -osharded-queue-test
+/// ```
+///
+/// ... and the run it:
+///
+/// ```
+/// $ ./sharded-queue-test
+/// ```
+///
+/// On successful execution the return code will be zero; some output is
+/// expected.
+///
+/// Which shard a value lands in depends on the CPU the test is running on, so
+/// the tests only check the properties which hold for any routing.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sharded-queue.h"
+
+#if QUEUE_MAX_LENGTH != 5
+#error Max queue length should be 5
+#endif
+
+static void test_push_pop() {
+    struct ShardedQueue queue;
+    sharded_queue_init(&queue, 2);
+    assert(queue.shards_count == 2);
+    assert(sharded_queue_size(&queue) == 0);
+
+    // Both shards together hold twice the capacity of a single queue.
+    for (uint32_t i = 0; i != 2 * QUEUE_MAX_LENGTH; ++i) {
+        assert(sharded_queue_push(&queue, i) == 0);
+    }
+    assert(sharded_queue_size(&queue) == 2 * QUEUE_MAX_LENGTH);
+    assert(sharded_queue_push(&queue, 100) == -1);
+
+    // Every value comes out exactly once, no matter which shard it's in.
+    unsigned seen = 0;
+    uint32_t value;
+    for (unsigned i = 0; i != 2 * QUEUE_MAX_LENGTH; ++i) {
+        assert(sharded_queue_pop(&queue, &value) == 0);
+        assert(value < 2 * QUEUE_MAX_LENGTH);
+        assert((seen & (1u << value)) == 0);
+        seen |= 1u << value;
+    }
+    assert(sharded_queue_pop(&queue, &value) == -1);
+    assert(sharded_queue_size(&queue) == 0);
+    sharded_queue_destroy(&queue);
+}
+
+static void test_merge_to() {
+    struct ShardedQueue queue;
+    sharded_queue_init(&queue, 3);
+    // Fill the shards by hand to get a predictable layout.
+    uint32_t shard0[] = {1, 4, 6};
+    uint32_t shard2[] = {3};
+    memcpy(queue.shards[0].queue.array, shard0, sizeof(shard0));
+    queue.shards[0].queue.size = 3;
+    memcpy(queue.shards[2].queue.array, shard2, sizeof(shard2));
+    queue.shards[2].queue.size = 1;
+    queue.shards[1].queue.begin = 4;
+    queue.shards[1].queue.array[4] = 2;
+    queue.shards[1].queue.array[0] = 5;
+    queue.shards[1].queue.size = 2;
+    // 1 + 2 + 3 + 4 + 5 + 6 = 6 elements, which is over the limit.
+    struct Queue destination;
+    queue_init(&destination);
+    assert(sharded_queue_merge_to(&queue, &destination) == -1);
+    assert(sharded_queue_size(&queue) == 6);
+
+    queue.shards[0].queue.size = 2;
+    assert(sharded_queue_merge_to(&queue, &destination) == 0);
+    {
+        uint32_t reference_array[] = {1, 2, 3, 4, 5};
+        assert(destination.size == 5);
+        uint32_t result[5];
+        queue_copy_to(&destination, result);
+        assert(memcmp(result, reference_array, sizeof(result)) == 0);
+    }
+    assert(sharded_queue_size(&queue) == 0);
+    sharded_queue_destroy(&queue);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    test_push_pop();
+    test_merge_to();
+}
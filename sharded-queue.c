@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sharded-queue.h"
+
+/// Returns a number of the shard which belongs to the current CPU.
+///
+/// `sched_getcpu` is served from the vDSO (and from the rseq area on recent
+/// glibc versions), so it doesn't cost a system call.
+static unsigned sharded_queue_home_shard(const struct ShardedQueue *queue);
+
+/// Pops a value out of a shard's queue according to the `QUEUE_MODE`. The
+/// shard should be locked and not empty.
+static void sharded_queue_pop_locked(struct Queue *queue, uint32_t *value);
+
+unsigned sharded_queue_home_shard(const struct ShardedQueue *queue) {
+    int cpu = sched_getcpu();
+    if (cpu < 0) {
+        // Can't tell the CPU, so all such threads will share the first shard.
+        cpu = 0;
+    }
+    return (unsigned)cpu % queue->shards_count;
+}
+
+void sharded_queue_pop_locked(struct Queue *queue, uint32_t *value) {
+#if QUEUE_MODE == QUEUE_MODE_FIFO
+    queue_pop_back(queue, value);
+#elif QUEUE_MODE == QUEUE_MODE_LIFO
+    queue_pop_front(queue, value);
+#endif
+}
+
+void sharded_queue_init(struct ShardedQueue *queue, unsigned shards_count) {
+    if (shards_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        shards_count = (cpus > 0) ? (unsigned)cpus : 1;
+    }
+    if (shards_count > SHARDED_QUEUE_MAX_SHARDS) {
+        shards_count = SHARDED_QUEUE_MAX_SHARDS;
+    }
+    queue->shards_count = shards_count;
+    for (unsigned i = 0; i != shards_count; ++i) {
+        pthread_mutex_init(&queue->shards[i].lock, NULL);
+        queue_init(&queue->shards[i].queue);
+    }
+}
+
+void sharded_queue_destroy(struct ShardedQueue *queue) {
+    for (unsigned i = 0; i != queue->shards_count; ++i) {
+        pthread_mutex_destroy(&queue->shards[i].lock);
+    }
+    queue->shards_count = 0;
+}
+
+int sharded_queue_push(struct ShardedQueue *queue, uint32_t value) {
+    unsigned home = sharded_queue_home_shard(queue);
+    for (unsigned i = 0; i != queue->shards_count; ++i) {
+        struct QueueShard *shard =
+            &queue->shards[(home + i) % queue->shards_count];
+        pthread_mutex_lock(&shard->lock);
+        // The size is checked beforehand, so a full shard doesn't make
+        // `queue_push_back` complain on the stderr.
+        if (shard->queue.size != QUEUE_MAX_LENGTH) {
+            queue_push_back(&shard->queue, value);
+            pthread_mutex_unlock(&shard->lock);
+            return 0;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    fprintf(stderr,
+            "Can't enqueue an element since all the shards have reached their "
+            "capacity\n");
+    return -1;
+}
+
+int sharded_queue_pop(struct ShardedQueue *queue, uint32_t *value) {
+    unsigned home = sharded_queue_home_shard(queue);
+    for (unsigned i = 0; i != queue->shards_count; ++i) {
+        struct QueueShard *shard =
+            &queue->shards[(home + i) % queue->shards_count];
+        pthread_mutex_lock(&shard->lock);
+        if (shard->queue.size != 0) {
+            sharded_queue_pop_locked(&shard->queue, value);
+            pthread_mutex_unlock(&shard->lock);
+            return 0;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return -1;
+}
+
+unsigned sharded_queue_size(struct ShardedQueue *queue) {
+    unsigned total = 0;
+    for (unsigned i = 0; i != queue->shards_count; ++i) {
+        struct QueueShard *shard = &queue->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        total += shard->queue.size;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return total;
+}
+
+int sharded_queue_merge_to(struct ShardedQueue *queue,
+                           struct Queue *destination) {
+    // The shards are always locked in the same order, so concurrent merges
+    // don't deadlock.
+    for (unsigned i = 0; i != queue->shards_count; ++i) {
+        pthread_mutex_lock(&queue->shards[i].lock);
+    }
+    unsigned total_len = 0;
+    for (unsigned i = 0; i != queue->shards_count; ++i) {
+        total_len += queue->shards[i].queue.size;
+    }
+    int rc = -1;
+    if (total_len <= QUEUE_MAX_LENGTH) {
+        const struct Queue *shard_queues[SHARDED_QUEUE_MAX_SHARDS];
+        for (unsigned i = 0; i != queue->shards_count; ++i) {
+            shard_queues[i] = &queue->shards[i].queue;
+        }
+        struct QueueZipIter iter;
+        queue_zip_iter_init(&iter, shard_queues, queue->shards_count);
+        queue_init(destination);
+        destination->size =
+            queue_zip_iter_next(&iter, destination->array, total_len);
+        for (unsigned i = 0; i != queue->shards_count; ++i) {
+            queue->shards[i].queue.size = 0;
+        }
+        rc = 0;
+    } else {
+        fprintf(stderr,
+                "Can't merge the shards since their combined size exceeds the "
+                "limit\n");
+    }
+    for (unsigned i = queue->shards_count; i != 0; --i) {
+        pthread_mutex_unlock(&queue->shards[i - 1].lock);
+    }
+    return rc;
+}
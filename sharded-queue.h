@@ -0,0 +1,76 @@
+#pragma once
+
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "configure.h"
+#include "queue.h"
+
+/// A single shard of a sharded queue: a plain `Queue` guarded by its own lock.
+///
+/// Shards are aligned to a cache line, so the locks of the neighbouring shards
+/// don't share one.
+struct QueueShard {
+    /// Protects the `queue`.
+    pthread_mutex_t lock;
+    /// The shard's storage.
+    struct Queue queue;
+} __attribute__((aligned(64)));
+
+/// A queue split into a number of independently locked shards, normally one
+/// per CPU core.
+///
+/// Pushes go to the shard of the CPU the calling thread is running on, and
+/// pops are served from the same shard first, stealing from the other shards
+/// in a round-robin manner when it's empty. Hence the ordering is only relaxed:
+/// each shard on its own behaves as a `QUEUE_MODE` queue, but there's no
+/// global order between elements which ended up in different shards.
+///
+/// ```
+/// shards_count = 3
+///
+///   CPU #0     CPU #1     CPU #2   CPU #3
+///      |          |          |        |
+///      v          v          v        |
+///  shards[0]  shards[1]  shards[2] <--'   (cpu % shards_count)
+/// ```
+///
+/// The total capacity is `shards_count * QUEUE_MAX_LENGTH`.
+struct ShardedQueue {
+    /// Number of the shards in use.
+    unsigned shards_count;
+    /// The shards.
+    struct QueueShard shards[SHARDED_QUEUE_MAX_SHARDS];
+};
+
+/// Initializes an empty sharded queue with a given number of shards. If
+/// `shards_count` is zero, the number of online CPUs is used. The number of
+/// shards is capped at `SHARDED_QUEUE_MAX_SHARDS`.
+void sharded_queue_init(struct ShardedQueue *queue, unsigned shards_count);
+
+/// Releases resources held by a sharded queue. The queue should not be in use
+/// by any thread.
+void sharded_queue_destroy(struct ShardedQueue *queue);
+
+/// Pushes a value to the shard of the current CPU. If that shard is full, the
+/// following shards are tried in turn. Returns -1 if all the shards are full.
+int sharded_queue_push(struct ShardedQueue *queue, uint32_t value);
+
+/// Pops a value from the shard of the current CPU, or steals one from another
+/// shard if that one is empty. Returns -1 if all the shards are empty.
+int sharded_queue_pop(struct ShardedQueue *queue, uint32_t *value);
+
+/// Returns an aggregate size of all the shards. The shards are inspected one
+/// after another, so under concurrent modifications the result is only an
+/// approximation.
+unsigned sharded_queue_size(struct ShardedQueue *queue);
+
+/// Moves all the elements into a single queue, interleaving the shards in a
+/// zipper manner: first elements of all the shards, then the second elements,
+/// and so on. The previous contents of the `destination` are discarded.
+///
+/// Combined size of the shards should not be greater than `QUEUE_MAX_LENGTH`,
+/// otherwise -1 is returned and nothing is moved. The shards are emptied on
+/// success.
+int sharded_queue_merge_to(struct ShardedQueue *queue,
+                           struct Queue *destination);
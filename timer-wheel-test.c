@@ -0,0 +1,283 @@
+/// Testing the `timer-wheel` and `delay-queue` modules.
+///
+/// To run the tests, first compile this file with the `timer-wheel.c`,
+/// `delay-queue.c` and `queue.c`, while passing a small wheel configuration to
+/// the compiler:
+///
+/// ```
+/// $ clang -DQUEUE_MAX_LENGTH=5 -DTIMER_WHEEL_BITS=2 -DTIMER_WHEEL_LEVELS=3 -DTIMER_WHEEL_CAPACITY=32 timer-wheel-test.c timer-wheel.c delay-queue.c queue.c -lpthread -otimer-wheel-test
+/// ```
+///
+/// ... and the run it:
+///
+/// ```
+/// $ ./timer-wheel-test
+/// ```
+///
+/// On successful execution the return code will be zero; some output is
+/// expected.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delay-queue.h"
+#include "timer-wheel.h"
+
+#if QUEUE_MAX_LENGTH != 5 || TIMER_WHEEL_BITS != 2 || \
+    TIMER_WHEEL_LEVELS != 3 || TIMER_WHEEL_CAPACITY != 32
+#error Unexpected timer wheel configuration
+#endif
+
+/// Advances a wheel tick by tick up to the `until` tick and checks every value
+/// fires exactly at the tick it's equal to.
+static void advance_exact(struct TimerWheel* wheel, uint64_t from,
+                          uint64_t until) {
+    for (uint64_t tick = from; tick <= until; ++tick) {
+        uint32_t values[TIMER_WHEEL_CAPACITY];
+        unsigned count =
+            timer_wheel_pop_expired(wheel, tick, values, TIMER_WHEEL_CAPACITY);
+        for (unsigned i = 0; i != count; ++i) {
+            assert(values[i] == tick);
+        }
+    }
+}
+
+static void test_levels() {
+    static struct TimerWheel wheel;
+    timer_wheel_init(&wheel, 3);
+    // The wheel spans 64 ticks: 4 ticks on the level 0, 16 on the level 1 and
+    // the rest on the level 2. The value of each timer is its due tick.
+    uint32_t dues[] = {3, 4, 6, 9, 17, 18, 40, 66, 67, 200};
+    for (unsigned i = 0; i != sizeof(dues) / sizeof(dues[0]); ++i) {
+        assert(timer_wheel_insert(&wheel, dues[i], dues[i], NULL) == 0);
+    }
+    assert(wheel.count == 10);
+    uint64_t deadline;
+    assert(timer_wheel_next_deadline(&wheel, &deadline) == 0);
+    assert(deadline == 3);
+
+    uint32_t values[TIMER_WHEEL_CAPACITY];
+    assert(timer_wheel_pop_expired(&wheel, 2, values, 10) == 0);
+    assert(timer_wheel_pop_expired(&wheel, 3, values, 10) == 1);
+    assert(values[0] == 3);
+    assert(timer_wheel_pop_expired(&wheel, 5, values, 10) == 1);
+    assert(values[0] == 4);
+    advance_exact(&wheel, 6, 199);
+    assert(wheel.count == 1);
+    assert(timer_wheel_pop_expired(&wheel, 200, values, 10) == 1);
+    assert(values[0] == 200);
+    assert(wheel.count == 0);
+    assert(timer_wheel_next_deadline(&wheel, &deadline) == -1);
+
+    // Overdue timers fire right away, without waiting for the next tick.
+    assert(wheel.now == 200);
+    assert(timer_wheel_insert(&wheel, 1, 1, NULL) == 0);
+    assert(timer_wheel_pop_expired(&wheel, 200, values, 10) == 1);
+    assert(values[0] == 1);
+}
+
+static void test_due_now() {
+    static struct TimerWheel wheel;
+    timer_wheel_init(&wheel, 10);
+    uint32_t values[TIMER_WHEEL_CAPACITY];
+    assert(timer_wheel_insert(&wheel, 1, 10, NULL) == 0);
+    assert(timer_wheel_pop_expired(&wheel, 10, values, 10) == 1);
+    assert(values[0] == 1);
+
+    // Even when the bucket of the current tick is full.
+    for (uint32_t i = 0; i != QUEUE_MAX_LENGTH + 2; ++i) {
+        assert(timer_wheel_insert(&wheel, i, 10, NULL) == 0);
+    }
+    assert(timer_wheel_pop_expired(&wheel, 10, values, QUEUE_MAX_LENGTH) ==
+           QUEUE_MAX_LENGTH);
+    assert(timer_wheel_pop_expired(&wheel, 10, values, 10) == 2);
+    assert(wheel.count == 0);
+}
+
+static void test_jumps() {
+    static struct TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+    uint32_t dues[] = {5, 30, 31, 150};
+    for (unsigned i = 0; i != sizeof(dues) / sizeof(dues[0]); ++i) {
+        assert(timer_wheel_insert(&wheel, dues[i], dues[i], NULL) == 0);
+    }
+    // Big steps, possibly over several cascades at once.
+    uint32_t values[TIMER_WHEEL_CAPACITY];
+    assert(timer_wheel_pop_expired(&wheel, 29, values, 10) == 1);
+    assert(values[0] == 5);
+    assert(timer_wheel_pop_expired(&wheel, 149, values, 10) == 2);
+    assert(values[0] == 30 && values[1] == 31);
+    assert(timer_wheel_pop_expired(&wheel, 1000, values, 10) == 1);
+    assert(values[0] == 150);
+}
+
+static void test_cancel() {
+    static struct TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+    uint32_t handles[3];
+    assert(timer_wheel_insert(&wheel, 1, 10, &handles[0]) == 0);
+    assert(timer_wheel_insert(&wheel, 2, 10, &handles[1]) == 0);
+    assert(timer_wheel_insert(&wheel, 3, 50, &handles[2]) == 0);
+    assert(timer_wheel_cancel(&wheel, handles[0]) == 0);
+    assert(timer_wheel_cancel(&wheel, handles[0]) == -1);
+    assert(timer_wheel_cancel(&wheel, handles[2]) == 0);
+    assert(wheel.count == 1);
+
+    uint32_t values[TIMER_WHEEL_CAPACITY];
+    assert(timer_wheel_pop_expired(&wheel, 100, values, 10) == 1);
+    assert(values[0] == 2);
+    assert(timer_wheel_cancel(&wheel, handles[1]) == -1);
+}
+
+static void test_congestion() {
+    static struct TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+    // Way more timers than a single bucket can hold are due at the same tick.
+    for (uint32_t i = 0; i != 22; ++i) {
+        assert(timer_wheel_insert(&wheel, i, 2, NULL) == 0);
+    }
+    uint32_t values[TIMER_WHEEL_CAPACITY];
+    assert(timer_wheel_pop_expired(&wheel, 1, values, 10) == 0);
+    // Values come in batches, none fires early, and none is more than
+    // `count / QUEUE_MAX_LENGTH` ticks late.
+    unsigned fired = 0;
+    for (uint64_t tick = 2; fired != 22; ++tick) {
+        unsigned count;
+        do {
+            count = timer_wheel_pop_expired(&wheel, tick, values, 3);
+            assert(count <= 3);
+            fired += count;
+        } while (count != 0);
+        assert(tick <= 2 + 22 / QUEUE_MAX_LENGTH);
+    }
+    assert(wheel.count == 0);
+
+    // Only running out of the entries makes an insertion fail.
+    for (uint32_t i = 0; i != TIMER_WHEEL_CAPACITY; ++i) {
+        assert(timer_wheel_insert(&wheel, i, 100, NULL) == 0);
+    }
+    assert(timer_wheel_insert(&wheel, 0, 100, NULL) == -1);
+    for (uint64_t tick = 100; wheel.count != 0; ++tick) {
+        unsigned count = timer_wheel_pop_expired(&wheel, tick, values,
+                                                 TIMER_WHEEL_CAPACITY);
+        (void)count;
+        assert(tick <= 100 + TIMER_WHEEL_CAPACITY / QUEUE_MAX_LENGTH);
+    }
+}
+
+static void test_cascade_congestion() {
+    static struct TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+    uint32_t values[TIMER_WHEEL_CAPACITY];
+    // A full level 1 bucket of timers due at 6 is cascaded at 4, when the level
+    // 0 buckets of both the ticks 5 and 6 are full already.
+    for (uint32_t i = 0; i != QUEUE_MAX_LENGTH; ++i) {
+        assert(timer_wheel_insert(&wheel, 100 + i, 6, NULL) == 0);
+    }
+    assert(timer_wheel_pop_expired(&wheel, 3, values, 10) == 0);
+    for (uint32_t i = 0; i != QUEUE_MAX_LENGTH; ++i) {
+        assert(timer_wheel_insert(&wheel, 200 + i, 6, NULL) == 0);
+        assert(timer_wheel_insert(&wheel, 300 + i, 5, NULL) == 0);
+    }
+    // The cascaded timers are a tick late, not a turn of the level 1 late.
+    unsigned fired[8] = {0};
+    for (uint64_t tick = 4; tick != 8; ++tick) {
+        unsigned count =
+            timer_wheel_pop_expired(&wheel, tick, values, TIMER_WHEEL_CAPACITY);
+        for (unsigned i = 0; i != count; ++i) {
+            assert(values[i] / 100 != 3 || tick == 5);
+            assert(values[i] / 100 == 3 || tick >= 6);
+        }
+        fired[tick] = count;
+    }
+    assert(fired[4] == 0);
+    assert(fired[5] == QUEUE_MAX_LENGTH);
+    assert(fired[6] == QUEUE_MAX_LENGTH);
+    assert(fired[7] == QUEUE_MAX_LENGTH);
+    assert(wheel.count == 0);
+}
+
+static void test_random() {
+    static struct TimerWheel wheel;
+    srand(42);
+    timer_wheel_init(&wheel, 0);
+    uint64_t now = 0;
+    unsigned scheduled = 0;
+    unsigned fired = 0;
+    for (unsigned round = 0; round != 2000; ++round) {
+        // The value of each timer is its due tick.
+        uint64_t due = now + rand() % 300;
+        if (timer_wheel_insert(&wheel, due, due, NULL) == 0) {
+            scheduled += 1;
+        }
+        now += rand() % 4;
+        uint32_t values[TIMER_WHEEL_CAPACITY];
+        unsigned count =
+            timer_wheel_pop_expired(&wheel, now, values, TIMER_WHEEL_CAPACITY);
+        for (unsigned i = 0; i != count; ++i) {
+            assert(values[i] <= now);
+        }
+        fired += count;
+    }
+    assert(fired + wheel.count == scheduled);
+}
+
+static void test_delay_queue() {
+    static struct DelayQueue queue;
+    delay_queue_init(&queue);
+    uint32_t values[4];
+    assert(delay_queue_pop_expired(&queue, values, 4) == 0);
+
+    uint64_t start = delay_queue_now();
+    uint32_t handle;
+    assert(delay_queue_schedule(&queue, 30, 30, NULL) == 0);
+    assert(delay_queue_schedule(&queue, 10, 10, NULL) == 0);
+    assert(delay_queue_schedule(&queue, 20, 20, &handle) == 0);
+    assert(delay_queue_cancel(&queue, handle) == 0);
+    assert(delay_queue_pop_wait(&queue, values, 4) == 1);
+    assert(values[0] == 10);
+    assert(delay_queue_now() - start >= 10);
+    assert(delay_queue_pop_wait(&queue, values, 4) == 1);
+    assert(values[0] == 30);
+    assert(delay_queue_now() - start >= 30);
+    delay_queue_destroy(&queue);
+}
+
+/// Schedules a value after a short pause.
+static void* delayed_producer(void* arg) {
+    struct DelayQueue* queue = arg;
+    struct timespec pause = {0, 20 * 1000000};
+    nanosleep(&pause, NULL);
+    assert(delay_queue_schedule(queue, 7, 5, NULL) == 0);
+    return NULL;
+}
+
+static void test_delay_queue_wakeup() {
+    static struct DelayQueue queue;
+    delay_queue_init(&queue);
+    // The consumer sleeps on an empty queue until the producer shows up.
+    pthread_t producer;
+    assert(pthread_create(&producer, NULL, delayed_producer, &queue) == 0);
+    uint32_t value;
+    assert(delay_queue_pop_wait(&queue, &value, 1) == 1);
+    assert(value == 7);
+    pthread_join(producer, NULL);
+    delay_queue_destroy(&queue);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    test_levels();
+    test_due_now();
+    test_jumps();
+    test_cancel();
+    test_congestion();
+    test_cascade_congestion();
+    test_random();
+    test_delay_queue();
+    test_delay_queue_wakeup();
+}
@@ -0,0 +1,322 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "timer-wheel.h"
+
+/// A mask of a bucket number within a level.
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/// A number of ticks the whole wheel spans.
+#define TIMER_WHEEL_SPAN \
+    (((uint64_t)1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+/// Puts a timer into a bucket according to its due time. If that bucket is
+/// full, the timer spills to the nearest non-full level 0 bucket from its due
+/// tick on (it's re-placed from there if it's not due yet), or to the overflow
+/// list if the whole level 0 is full.
+static void timer_wheel_place(struct TimerWheel *wheel, uint32_t handle);
+
+/// Tries to push a timer handle into a given bucket. Returns -1 if the bucket
+/// is full.
+static int timer_wheel_push(struct TimerWheel *wheel, uint32_t handle,
+                            unsigned level, unsigned bucket);
+
+/// Puts a timer to the overflow list.
+static void timer_wheel_overflow(struct TimerWheel *wheel, uint32_t handle);
+
+/// Re-inserts the timers of the current bucket of a given level to the lower
+/// levels.
+static void timer_wheel_cascade(struct TimerWheel *wheel, unsigned level);
+
+/// Fires the expired timers of the level 0 bucket of the current tick and of
+/// the overflow list, and re-places the rest of them. Returns the number of
+/// the values written.
+static unsigned timer_wheel_drain(struct TimerWheel *wheel, uint32_t *values,
+                                  unsigned max_count);
+
+/// Returns an entry to the free list.
+static void timer_wheel_release(struct TimerWheel *wheel, uint32_t handle);
+
+int timer_wheel_push(struct TimerWheel *wheel, uint32_t handle, unsigned level,
+                     unsigned bucket) {
+    struct Queue *queue = &wheel->buckets[level][bucket];
+    // The size is checked beforehand, so a full bucket doesn't make
+    // `queue_push_back` complain on the stderr.
+    if (queue->size == QUEUE_MAX_LENGTH) {
+        return -1;
+    }
+    queue_push_back(queue, handle);
+    wheel->entries[handle].level = level;
+    wheel->entries[handle].bucket = bucket;
+    return 0;
+}
+
+void timer_wheel_overflow(struct TimerWheel *wheel, uint32_t handle) {
+    wheel->entries[handle].level = TIMER_WHEEL_LEVELS;
+    wheel->entries[handle].next = wheel->overflow_head;
+    wheel->overflow_head = handle;
+}
+
+void timer_wheel_place(struct TimerWheel *wheel, uint32_t handle) {
+    uint64_t due = wheel->entries[handle].due;
+    if (due <= wheel->now) {
+        // The bucket of the current tick is drained on every pop.
+        if (timer_wheel_push(wheel, handle, 0,
+                             wheel->now & TIMER_WHEEL_MASK) == -1) {
+            timer_wheel_overflow(wheel, handle);
+        }
+        return;
+    }
+    if (due - wheel->now >= TIMER_WHEEL_SPAN) {
+        // Too far in the future: park it at the farthest bucket of the top
+        // level, it will be re-inserted from there.
+        due = wheel->now + TIMER_WHEEL_SPAN - 1;
+    }
+    uint64_t delta = due - wheel->now;
+    unsigned level = 0;
+    while (level != TIMER_WHEEL_LEVELS - 1 &&
+           delta >= ((uint64_t)1) << ((level + 1) * TIMER_WHEEL_BITS)) {
+        level += 1;
+    }
+    unsigned bucket = (due >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+    if (timer_wheel_push(wheel, handle, level, bucket) == 0) {
+        return;
+    }
+    // A timer which is due within the level 0 ends up a few ticks late, and
+    // the farther ones are simply looked at again a turn of the level 0 later.
+    uint64_t from = (level == 0) ? due : wheel->now + TIMER_WHEEL_SLOTS - 1;
+    for (unsigned i = 0; i != TIMER_WHEEL_SLOTS; ++i) {
+        if (timer_wheel_push(wheel, handle, 0,
+                             (from + i) & TIMER_WHEEL_MASK) == 0) {
+            return;
+        }
+    }
+    timer_wheel_overflow(wheel, handle);
+}
+
+void timer_wheel_cascade(struct TimerWheel *wheel, unsigned level) {
+    unsigned bucket =
+        (wheel->now >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+    struct Queue *queue = &wheel->buckets[level][bucket];
+    // Take all the handles out first, since some of them might go right back
+    // into the same bucket.
+    uint32_t handles[QUEUE_MAX_LENGTH];
+    unsigned count = 0;
+    while (queue->size != 0) {
+        queue_pop_front(queue, &handles[count]);
+        count += 1;
+    }
+    for (unsigned i = 0; i != count; ++i) {
+        timer_wheel_place(wheel, handles[i]);
+    }
+}
+
+unsigned timer_wheel_drain(struct TimerWheel *wheel, uint32_t *values,
+                           unsigned max_count) {
+    unsigned written = 0;
+    struct Queue *queue = &wheel->buckets[0][wheel->now & TIMER_WHEEL_MASK];
+    // Only look at the timers which are in the bucket already, the re-placed
+    // ones might go right back.
+    unsigned pending = queue->size;
+    while (pending != 0 && written != max_count) {
+        uint32_t handle;
+        queue_pop_front(queue, &handle);
+        pending -= 1;
+        struct TimerWheelEntry *entry = &wheel->entries[handle];
+        if (entry->due <= wheel->now) {
+            values[written] = entry->value;
+            written += 1;
+            timer_wheel_release(wheel, handle);
+        } else {
+            timer_wheel_place(wheel, handle);
+        }
+    }
+
+    uint32_t handle = wheel->overflow_head;
+    wheel->overflow_head = TIMER_WHEEL_CAPACITY;
+    while (handle != TIMER_WHEEL_CAPACITY) {
+        struct TimerWheelEntry *entry = &wheel->entries[handle];
+        uint32_t next = entry->next;
+        if (entry->due > wheel->now) {
+            timer_wheel_place(wheel, handle);
+        } else if (written != max_count) {
+            values[written] = entry->value;
+            written += 1;
+            timer_wheel_release(wheel, handle);
+        } else {
+            // Out of room in the `values`, it goes next time.
+            timer_wheel_overflow(wheel, handle);
+        }
+        handle = next;
+    }
+    return written;
+}
+
+void timer_wheel_release(struct TimerWheel *wheel, uint32_t handle) {
+    struct TimerWheelEntry *entry = &wheel->entries[handle];
+    entry->active = 0;
+    entry->next = wheel->free_head;
+    wheel->free_head = handle;
+    wheel->count -= 1;
+}
+
+void timer_wheel_init(struct TimerWheel *wheel, uint64_t now) {
+    wheel->now = now;
+    wheel->count = 0;
+    wheel->overflow_head = TIMER_WHEEL_CAPACITY;
+    for (unsigned level = 0; level != TIMER_WHEEL_LEVELS; ++level) {
+        for (unsigned bucket = 0; bucket != TIMER_WHEEL_SLOTS; ++bucket) {
+            queue_init(&wheel->buckets[level][bucket]);
+        }
+    }
+    for (uint32_t i = 0; i != TIMER_WHEEL_CAPACITY; ++i) {
+        wheel->entries[i].active = 0;
+        wheel->entries[i].next = i + 1;
+    }
+    wheel->free_head = 0;
+}
+
+int timer_wheel_insert(struct TimerWheel *wheel, uint32_t value, uint64_t due,
+                       uint32_t *handle) {
+    if (wheel->free_head == TIMER_WHEEL_CAPACITY) {
+        fprintf(stderr,
+                "Can't schedule a timer since the capacity of the wheel has "
+                "been reached\n");
+        return -1;
+    }
+    uint32_t new_handle = wheel->free_head;
+    struct TimerWheelEntry *entry = &wheel->entries[new_handle];
+    entry->due = due;
+    entry->value = value;
+    wheel->free_head = entry->next;
+    timer_wheel_place(wheel, new_handle);
+    entry->active = 1;
+    wheel->count += 1;
+    if (handle != NULL) {
+        *handle = new_handle;
+    }
+    return 0;
+}
+
+int timer_wheel_cancel(struct TimerWheel *wheel, uint32_t handle) {
+    if (handle >= TIMER_WHEEL_CAPACITY || !wheel->entries[handle].active) {
+        return -1;
+    }
+    struct TimerWheelEntry *entry = &wheel->entries[handle];
+    if (entry->level == TIMER_WHEEL_LEVELS) {
+        uint32_t *link = &wheel->overflow_head;
+        while (*link != handle) {
+            link = &wheel->entries[*link].next;
+        }
+        *link = entry->next;
+        timer_wheel_release(wheel, handle);
+        return 0;
+    }
+    struct Queue *queue = &wheel->buckets[entry->level][entry->bucket];
+    unsigned index;
+    int rc = queue_find(queue, handle, &index);
+    assert(rc == 0);
+    (void)rc;
+    queue_remove(queue, index);
+    timer_wheel_release(wheel, handle);
+    return 0;
+}
+
+unsigned timer_wheel_pop_expired(struct TimerWheel *wheel, uint64_t now,
+                                 uint32_t *values, unsigned max_count) {
+    if (now < wheel->now) {
+        return 0;
+    }
+    // Whatever is due at the current tick goes first: it might have been
+    // scheduled or left over since the tick was processed.
+    unsigned written = timer_wheel_drain(wheel, values, max_count);
+    while (written != max_count && wheel->now < now) {
+        if (wheel->count == 0) {
+            // Nothing to wait for, just catch up with the time.
+            wheel->now = now;
+            break;
+        }
+        // Skip the ticks where there's nothing to do.
+        uint64_t next = wheel->now + 1;
+        uint64_t deadline;
+        if (timer_wheel_next_deadline(wheel, &deadline) == 0 &&
+            deadline > next) {
+            next = deadline;
+        }
+        if (next > now) {
+            wheel->now = now;
+            break;
+        }
+        wheel->now = next;
+        // Higher levels go first, since they might cascade down to a lower
+        // level bucket which is due right now as well.
+        for (unsigned level = TIMER_WHEEL_LEVELS - 1; level != 0; --level) {
+            uint64_t span = ((uint64_t)1) << (level * TIMER_WHEEL_BITS);
+            if (wheel->now % span == 0) {
+                timer_wheel_cascade(wheel, level);
+            }
+        }
+        written += timer_wheel_drain(wheel, values + written,
+                                     max_count - written);
+    }
+    return written;
+}
+
+int timer_wheel_next_deadline(const struct TimerWheel *wheel,
+                              uint64_t *deadline) {
+    if (wheel->count == 0) {
+        return -1;
+    }
+    // Timers which have already expired are waiting in the bucket of the
+    // current tick or in the overflow list.
+    const struct Queue *queue =
+        &wheel->buckets[0][wheel->now & TIMER_WHEEL_MASK];
+    for (unsigned i = 0; i != queue->size; ++i) {
+        if (wheel->entries[queue_get_value(queue, i)].due <= wheel->now) {
+            *deadline = wheel->now;
+            return 0;
+        }
+    }
+    for (uint32_t handle = wheel->overflow_head;
+         handle != TIMER_WHEEL_CAPACITY;
+         handle = wheel->entries[handle].next) {
+        if (wheel->entries[handle].due <= wheel->now) {
+            *deadline = wheel->now;
+            return 0;
+        }
+    }
+    if (wheel->overflow_head != TIMER_WHEEL_CAPACITY) {
+        // The overflow list is looked at on every tick.
+        *deadline = wheel->now + 1;
+        return 0;
+    }
+    uint64_t earliest = UINT64_MAX;
+    for (unsigned i = 1; i <= TIMER_WHEEL_SLOTS; ++i) {
+        uint64_t tick = wheel->now + i;
+        if (wheel->buckets[0][tick & TIMER_WHEEL_MASK].size != 0) {
+            earliest = tick;
+            break;
+        }
+    }
+    for (unsigned level = 1; level != TIMER_WHEEL_LEVELS; ++level) {
+        unsigned shift = level * TIMER_WHEEL_BITS;
+        uint64_t current = wheel->now >> shift;
+        // A bucket is cascaded when the time reaches its start, so the one
+        // the `now` lies in has already been cascaded and comes next a full
+        // turn later.
+        for (unsigned i = 1; i <= TIMER_WHEEL_SLOTS; ++i) {
+            uint64_t tick = (current + i) << shift;
+            if (tick >= earliest) {
+                break;
+            }
+            if (wheel->buckets[level][(current + i) & TIMER_WHEEL_MASK].size !=
+                0) {
+                earliest = tick;
+                break;
+            }
+        }
+    }
+    // Every timer sits in some bucket, but just in case.
+    *deadline = (earliest == UINT64_MAX) ? wheel->now + 1 : earliest;
+    return 0;
+}
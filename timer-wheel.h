@@ -0,0 +1,108 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "configure.h"
+#include "queue.h"
+
+/// A number of buckets on every level of a timer wheel.
+#define TIMER_WHEEL_SLOTS (1u << TIMER_WHEEL_BITS)
+
+/// A timer stored in a timer wheel.
+struct TimerWheelEntry {
+    /// The tick the timer is due at.
+    uint64_t due;
+    /// The value the timer carries.
+    uint32_t value;
+    /// Whether the timer is scheduled. Inactive entries form a free list.
+    int active;
+    /// Level of the bucket the timer is stored in; `TIMER_WHEEL_LEVELS` if the
+    /// timer is in the overflow list.
+    unsigned level;
+    /// Number of the bucket within the level.
+    unsigned bucket;
+    /// Next entry of the free list or of the overflow list.
+    uint32_t next;
+};
+
+/// A hierarchical timing wheel of values, each one due at a given tick.
+///
+/// Each level has `TIMER_WHEEL_SLOTS` buckets, and a bucket on the level `l`
+/// spans `TIMER_WHEEL_SLOTS^l` ticks, so the level 0 has a bucket per tick:
+///
+/// ```
+/// TIMER_WHEEL_BITS   = 2
+/// TIMER_WHEEL_LEVELS = 2
+/// now                = 5
+///
+/// level 1:  [ 0..3 ][ 4..7 ][ 8..11 ][ 12..15 ]   <- a bucket per 4 ticks
+/// level 0:  [  4   ][  5   ][   6   ][   7    ]   <- a bucket per tick
+///                       ^
+///                      now
+/// ```
+///
+/// A timer is put on the lowest level which spans its due time. When the time
+/// reaches the start of a higher level bucket, its timers are re-inserted
+/// (cascaded) to the lower levels, hence they eventually end up in the level 0
+/// bucket of their own tick.
+///
+/// The buckets are plain `Queue`s of timer handles, i.e. numbers of the
+/// entries, so inserting and cancelling a timer is O(1) (cancelling scans a
+/// single bucket of at most `QUEUE_MAX_LENGTH` handles). Timers of a bucket
+/// fire in the order of insertion.
+///
+/// The capacity of a bucket is limited, so when a bucket is full a timer
+/// spills to the nearest non-full level 0 bucket from its due tick on, and is
+/// re-inserted from there if it's not due yet. If the whole level 0 is full,
+/// the timer goes to the overflow list, which is looked at on every tick (and
+/// which is scanned to cancel a timer).
+/// Timers never fire before their due time, but they may fire late if too many
+/// timers are due at about the same time: a timer is at most
+/// `count / QUEUE_MAX_LENGTH` ticks late, `count` being the largest number of
+/// the scheduled timers while it's waiting.
+struct TimerWheel {
+    /// The last processed tick.
+    uint64_t now;
+    /// Number of the scheduled timers.
+    unsigned count;
+    /// Head of the free entries list; `TIMER_WHEEL_CAPACITY` if there are no
+    /// free entries.
+    uint32_t free_head;
+    /// Head of the list of the timers which didn't fit into any bucket;
+    /// `TIMER_WHEEL_CAPACITY` if the list is empty.
+    uint32_t overflow_head;
+    /// The buckets.
+    struct Queue buckets[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    /// The timers.
+    struct TimerWheelEntry entries[TIMER_WHEEL_CAPACITY];
+};
+
+/// Initializes an empty timer wheel starting at a given tick.
+void timer_wheel_init(struct TimerWheel *wheel, uint64_t now);
+
+/// Schedules a `value` at a `due` tick and stores its handle into the `handle`
+/// (unless it's `NULL`). Timers which are due at or before the last processed
+/// tick (`wheel->now`) are returned by the next `timer_wheel_pop_expired`.
+/// Returns -1 if there are no free entries.
+int timer_wheel_insert(struct TimerWheel *wheel, uint32_t value, uint64_t due,
+                       uint32_t *handle);
+
+/// Cancels a scheduled timer. Returns -1 if the timer is not scheduled (say,
+/// it has already fired). Note that handles are reused once timers fire or get
+/// cancelled.
+int timer_wheel_cancel(struct TimerWheel *wheel, uint32_t handle);
+
+/// Advances the wheel up to the `now` tick (inclusive), writing the values of
+/// the expired timers into the `values` array. At most `max_count` values are
+/// written; the rest is returned by the next call, even at the same `now`. A
+/// `now` before the last processed tick expires nothing. Returns the number of
+/// the values written.
+unsigned timer_wheel_pop_expired(struct TimerWheel *wheel, uint64_t now,
+                                 uint32_t *values, unsigned max_count);
+
+/// Finds the earliest tick at which `timer_wheel_pop_expired` has something to
+/// do, i.e. either a timer might expire or the timers of a higher level bucket
+/// should be cascaded. That's the last processed tick (`wheel->now`) if some
+/// timers have already expired. Returns -1 if there are no timers.
+int timer_wheel_next_deadline(const struct TimerWheel *wheel,
+                              uint64_t *deadline);